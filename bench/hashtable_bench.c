@@ -0,0 +1,121 @@
+/*
+ * Insert, lookup and iteration cost of jansson objects from 1 to 10,000 keys.
+ * Only uses the public API, so the same program runs against any jansson
+ * build. See bench/README.md for how to build it.
+ */
+
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_KEYS 10000
+
+/* keys inserted per size, so every size does about the same work */
+#define KEYS_PER_SIZE 2000000
+
+/* each size is measured this many times and the fastest run is kept */
+#define RUNS 5
+
+typedef struct {
+    double insert;
+    double hit;
+    double miss;
+    double iterate;
+} timings_t;
+
+static char keys[MAX_KEYS][24];
+static char missing[MAX_KEYS][24];
+
+/* keeps the loops from being optimized away */
+static long checksum;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void measure(int n, timings_t *timings) {
+    int reps = KEYS_PER_SIZE / n;
+    json_t *object = NULL;
+    const char *key;
+    json_t *value;
+    double start;
+    int r, k;
+
+    /* building and freeing objects, as a decoder does */
+    start = now();
+    for (r = 0; r < reps; r++) {
+        json_t *built = json_object();
+        for (k = 0; k < n; k++)
+            json_object_set_new_nocheck(built, keys[k], json_integer(k));
+
+        if (object)
+            json_decref(object);
+        object = built;
+    }
+    timings->insert = now() - start;
+
+    /* keys are visited out of insertion order */
+    start = now();
+    for (r = 0; r < reps; r++) {
+        for (k = 0; k < n; k++)
+            checksum += json_object_get(object, keys[(k * 7919) % n]) != NULL;
+    }
+    timings->hit = now() - start;
+
+    start = now();
+    for (r = 0; r < reps; r++) {
+        for (k = 0; k < n; k++)
+            checksum += json_object_get(object, missing[k]) != NULL;
+    }
+    timings->miss = now() - start;
+
+    start = now();
+    for (r = 0; r < reps; r++) {
+        json_object_foreach(object, key, value) { checksum += json_integer_value(value); }
+    }
+    timings->iterate = now() - start;
+
+    json_decref(object);
+}
+
+static double fastest(double a, double b) { return b < a ? b : a; }
+
+int main(void) {
+    static const int sizes[] = {1, 2, 4, 8, 9, 16, 64, 256, 1000, 10000};
+    size_t i, s;
+    int run;
+
+    for (i = 0; i < MAX_KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "field_%d", (int)i);
+        snprintf(missing[i], sizeof(missing[i]), "absent_%d", (int)i);
+    }
+
+    printf("%6s %12s %12s %12s %12s\n", "keys", "insert ns", "hit ns", "miss ns",
+           "iterate ns");
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        double total = (double)(KEYS_PER_SIZE / n) * n;
+        timings_t best, timings;
+
+        measure(n, &best);
+        for (run = 1; run < RUNS; run++) {
+            measure(n, &timings);
+            best.insert = fastest(best.insert, timings.insert);
+            best.hit = fastest(best.hit, timings.hit);
+            best.miss = fastest(best.miss, timings.miss);
+            best.iterate = fastest(best.iterate, timings.iterate);
+        }
+
+        printf("%6d %12.1f %12.1f %12.1f %12.1f\n", n, best.insert / total * 1e9,
+               best.hit / total * 1e9, best.miss / total * 1e9,
+               best.iterate / total * 1e9);
+    }
+
+    fprintf(stderr, "checksum %ld\n", checksum);
+    return 0;
+}
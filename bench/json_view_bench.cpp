@@ -0,0 +1,251 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Parse throughput and peak memory of JSONViewDocument::Parse against json_loads.
+// Pass JSON files to measure them, otherwise 1 MB and 5 MB documents shaped like
+// a scoreboard dump are generated. See bench/README.md for how to build it.
+
+#include "json_path.h"
+#include "json_view.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#define BENCH_RUNS 10
+
+static size_t g_CurrentBytes;
+static size_t g_PeakBytes;
+
+// Every allocation carries its size in front, so both C++ and jansson allocations are counted.
+static void *CountedAlloc(size_t size)
+{
+	size_t *block = (size_t *)malloc(size + sizeof(max_align_t));
+	if (block == nullptr)
+	{
+		return nullptr;
+	}
+
+	*block = size;
+	g_CurrentBytes += size;
+	g_PeakBytes = std::max(g_PeakBytes, g_CurrentBytes);
+	return (char *)block + sizeof(max_align_t);
+}
+
+static void CountedFree(void *ptr)
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+
+	size_t *block = (size_t *)((char *)ptr - sizeof(max_align_t));
+	g_CurrentBytes -= *block;
+	free(block);
+}
+
+void *operator new(size_t size)
+{
+	void *ptr = CountedAlloc(size);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	CountedFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	CountedFree(ptr);
+}
+
+static std::string GeneratePayload(size_t targetSize)
+{
+	std::string text = "{\"server\":\"bench\",\"tick\":128,\"players\":[";
+	char buffer[512];
+	for (int i = 0; text.size() < targetSize; i++)
+	{
+		snprintf(buffer, sizeof(buffer),
+			"%s{\"steamid\":\"STEAM_1:%d:%d\",\"name\":\"Player \\\"%d\\\"\",\"team\":%d,\"alive\":%s,"
+			"\"stats\":{\"kills\":%d,\"deaths\":%d,\"accuracy\":%.4f,\"damage\":%d.%02d},"
+			"\"position\":[%.3f,%.3f,%.3f],\"weapons\":[\"ak47\",\"deagle\",\"knife\"]}",
+			i == 0 ? "" : ",", i & 1, 100000 + i, i, i % 2 + 2, (i % 3) ? "true" : "false",
+			i % 40, i % 25, (i % 1000) / 1000.0, i * 7, i % 100,
+			i * 1.25 - 500.0, i * -0.75 + 200.0, (i % 64) * 1.5);
+		text.append(buffer);
+	}
+	text.append("]}");
+	return text;
+}
+
+static bool ReadFile(const char *path, std::string &text)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		text.append(buffer, read);
+	}
+	fclose(file);
+	return true;
+}
+
+struct Result
+{
+	double parseMs;
+	double readMs;
+	size_t peakBytes;
+	size_t retainedBytes;
+};
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reads three fields the way a plugin would, after the parse
+static const char *g_Paths[] = {"tick", "players[0].stats.kills", "players[0].name"};
+
+static Result BenchLoads(const std::string &text, size_t flags)
+{
+	Result result = {1e30, 1e30, 0, 0};
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		size_t base = g_CurrentBytes;
+		g_PeakBytes = base;
+
+		auto start = std::chrono::steady_clock::now();
+		json_error_t error;
+		json_t *root = json_loadb(text.data(), text.size(), flags, &error);
+		result.parseMs = std::min(result.parseMs, ElapsedMs(start));
+		if (root == nullptr)
+		{
+			fprintf(stderr, "json_loads: %s\n", error.text);
+			exit(1);
+		}
+		result.peakBytes = g_PeakBytes - base;
+		result.retainedBytes = g_CurrentBytes - base;
+
+		start = std::chrono::steady_clock::now();
+		std::string pathError;
+		for (const char *path : g_Paths)
+		{
+			if (JSONPath::Compile(path, pathError)->Get(root) == nullptr)
+			{
+				fprintf(stderr, "json_loads: no value at %s\n", path);
+			}
+		}
+		result.readMs = std::min(result.readMs, ElapsedMs(start));
+
+		json_decref(root);
+	}
+	return result;
+}
+
+static Result BenchView(const std::string &text)
+{
+	Result result = {1e30, 1e30, 0, 0};
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		size_t base = g_CurrentBytes;
+		g_PeakBytes = base;
+
+		auto start = std::chrono::steady_clock::now();
+		std::string error;
+		std::shared_ptr<JSONViewDocument> document = JSONViewDocument::Parse(text.data(), text.size(), error);
+		result.parseMs = std::min(result.parseMs, ElapsedMs(start));
+		if (document == nullptr)
+		{
+			fprintf(stderr, "JSONView: %s\n", error.c_str());
+			exit(1);
+		}
+		result.peakBytes = g_PeakBytes - base;
+		result.retainedBytes = g_CurrentBytes - base;
+
+		start = std::chrono::steady_clock::now();
+		std::string pathError;
+		for (const char *path : g_Paths)
+		{
+			if (document->Find(0, *JSONPath::Compile(path, pathError)) == JSONViewDocument::npos)
+			{
+				fprintf(stderr, "JSONView: no value at %s\n", path);
+			}
+		}
+		result.readMs = std::min(result.readMs, ElapsedMs(start));
+	}
+	return result;
+}
+
+static void PrintRow(const char *name, const Result &result, double megabytes)
+{
+	printf("  %-22s %9.2f %9.1f %9.2f %12.2f %11.1f\n", name, result.parseMs, megabytes / (result.parseMs / 1000.0),
+		result.peakBytes / 1048576.0, result.retainedBytes / 1048576.0, result.readMs * 1000.0);
+}
+
+static void Report(const char *name, const std::string &text)
+{
+	double megabytes = text.size() / 1048576.0;
+	printf("%s (%.2f MB)\n", name, megabytes);
+	printf("  %-22s %9s %9s %9s %12s %11s\n", "", "parse ms", "MB/s", "peak MB", "retained MB", "3 reads us");
+
+	PrintRow("json_loads", BenchLoads(text, 0), megabytes);
+	PrintRow("json_loads arena+keys", BenchLoads(text, JSON_DECODE_ARENA | JSON_DECODE_INTERN_KEYS), megabytes);
+	PrintRow("JSONView", BenchView(text), megabytes);
+}
+
+int main(int argc, char **argv)
+{
+	json_set_alloc_funcs(&CountedAlloc, &CountedFree);
+
+	if (argc > 1)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string text;
+			if (!ReadFile(argv[i], text))
+			{
+				fprintf(stderr, "Could not read %s\n", argv[i]);
+				return 1;
+			}
+			Report(argv[i], text);
+		}
+		return 0;
+	}
+
+	Report("generated", GeneratePayload(1 << 20));
+	Report("generated", GeneratePayload(5 << 20));
+	return 0;
+}
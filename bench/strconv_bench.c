@@ -0,0 +1,166 @@
+/*
+ * Encoding and decoding speed of number-heavy JSON, plus a check of how
+ * often json_dumps() prints more digits than the shortest string that reads
+ * back as the same double. Only uses the public API, so the same program
+ * runs against any jansson build. See bench/README.md for how to build it.
+ */
+
+#include <jansson.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define VALUES 900000
+#define RUNS 5
+#define SHORTEST_SAMPLES 1000000
+#define SHORTEST_EXAMPLES 10
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random(void) {
+    /* xorshift64*, reproducible across runs */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Any finite double, drawn from random bit patterns */
+static double random_double(void) {
+    double value;
+    uint64_t bits;
+
+    do {
+        bits = next_random();
+        memcpy(&value, &bits, sizeof(value));
+    } while (value != value || value - value != 0);
+
+    return value;
+}
+
+/* Coordinates and stats as game servers send them, two decimals */
+static double random_position(void) {
+    return (double)((int64_t)(next_random() % 2000000) - 1000000) / 100.0;
+}
+
+static void bench(const char *name, double (*generate)(void)) {
+    json_t *array = json_array();
+    double start, dump_time = 0, load_time = 0;
+    char *text = NULL;
+    size_t i;
+    int run;
+
+    for (i = 0; i < VALUES; i++)
+        json_array_append_new(array, json_real(generate()));
+
+    for (run = 0; run < RUNS; run++) {
+        json_t *loaded;
+        json_error_t error;
+        double elapsed;
+
+        free(text);
+        start = now();
+        text = json_dumps(array, JSON_COMPACT);
+        elapsed = now() - start;
+        if (run == 0 || elapsed < dump_time)
+            dump_time = elapsed;
+
+        start = now();
+        loaded = json_loads(text, 0, &error);
+        elapsed = now() - start;
+        if (run == 0 || elapsed < load_time)
+            load_time = elapsed;
+
+        if (!loaded || !json_equal(loaded, array)) {
+            fprintf(stderr, "%s: values did not round trip\n", name);
+            exit(1);
+        }
+        json_decref(loaded);
+    }
+
+    printf("%-22s %9.1f %9.1f %9.1f\n", name, strlen(text) / 1048576.0, dump_time * 1000,
+           load_time * 1000);
+
+    free(text);
+    json_decref(array);
+}
+
+/* Significant digits of a number printed as [-]d[.ddd][e[+-]x] */
+static int significant_digits(const char *str) {
+    int digits = 0, trailing_zeros = 0, leading = 1;
+
+    for (; *str && *str != 'e' && *str != 'E'; str++) {
+        if (*str < '0' || *str > '9')
+            continue;
+        if (leading && *str == '0')
+            continue;
+        leading = 0;
+        digits++;
+        trailing_zeros = (*str == '0') ? trailing_zeros + 1 : 0;
+    }
+
+    return digits - trailing_zeros;
+}
+
+/* Fewest %g digits that read back as value */
+static int shortest_digits(double value, char *shortest, size_t size) {
+    int precision;
+
+    for (precision = 1; precision < 17; precision++) {
+        snprintf(shortest, size, "%.*g", precision, value);
+        if (strtod(shortest, NULL) == value)
+            break;
+    }
+    snprintf(shortest, size, "%.*g", precision, value);
+    return significant_digits(shortest);
+}
+
+static void check_shortest(double value, long *longer, long *mismatches, int *examples) {
+    json_t *real = json_real(value);
+    char *dumped = json_dumps(real, JSON_ENCODE_ANY);
+    char shortest[32];
+    int expected = shortest_digits(value, shortest, sizeof(shortest));
+
+    if (strtod(dumped, NULL) != value)
+        (*mismatches)++;
+
+    if (significant_digits(dumped) > expected) {
+        (*longer)++;
+        if (*examples < SHORTEST_EXAMPLES) {
+            printf("  %-26s shortest %s\n", dumped, shortest);
+            (*examples)++;
+        }
+    }
+
+    free(dumped);
+    json_decref(real);
+}
+
+int main(void) {
+    static const double known[] = {1e23, 5e-324, 0.1, 0.3, 1.0 / 3.0, 123456.789, 9007199254740993.0};
+    long longer = 0, mismatches = 0;
+    int examples = 0;
+    size_t i;
+
+    printf("%-22s %9s %9s %9s\n", "900k values", "MB", "dump ms", "load ms");
+    bench("two decimals", random_position);
+    bench("random doubles", random_double);
+
+    printf("\nnumbers printed with more digits than needed:\n");
+    for (i = 0; i < sizeof(known) / sizeof(known[0]); i++)
+        check_shortest(known[i], &longer, &mismatches, &examples);
+    for (i = 0; i < SHORTEST_SAMPLES; i++)
+        check_shortest(random_double(), &longer, &mismatches, &examples);
+
+    printf("%ld of %ld longer than the shortest form, %ld did not round trip\n", longer,
+           (long)(SHORTEST_SAMPLES + sizeof(known) / sizeof(known[0])), mismatches);
+    return 0;
+}
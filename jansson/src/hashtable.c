@@ -21,21 +21,23 @@
 #include <jansson_config.h>  /* for JSON_INLINE */
 
 #ifndef INITIAL_HASHTABLE_ORDER
-#define INITIAL_HASHTABLE_ORDER 3
+#define INITIAL_HASHTABLE_ORDER 4
 #endif
 
 typedef struct hashtable_list list_t;
 typedef struct hashtable_pair pair_t;
-typedef struct hashtable_bucket bucket_t;
+typedef struct hashtable_slot slot_t;
 
 extern volatile uint32_t hashtable_seed;
 
 /* Implementation of the hash function */
-#include "lookup3.h"
+#include "wyhash.h"
+
+#define hashsize(n) ((size_t)1 << (n))
+#define hashmask(n) (hashsize(n) - 1)
 
-#define list_to_pair(list_)         container_of(list_, pair_t, list)
 #define ordered_list_to_pair(list_) container_of(list_, pair_t, ordered_list)
-#define hash_str(key, len)          ((size_t)hashlittle((key), len, hashtable_seed))
+#define hash_str(key, len)          ((size_t)wyhash((key), len, hashtable_seed))
 
 static JSON_INLINE void list_init(list_t *list) {
     list->next = list;
@@ -54,72 +56,100 @@ static JSON_INLINE void list_remove(list_t *list) {
     list->next->prev = list->prev;
 }
 
-static JSON_INLINE int bucket_is_empty(hashtable_t *hashtable, bucket_t *bucket) {
-    return bucket->first == &hashtable->list && bucket->first == bucket->last;
+static JSON_INLINE int pair_matches(pair_t *pair, const char *key, size_t key_len,
+                                    size_t hash) {
+    return pair->key->hash == hash && pair->key->len == key_len &&
+           (pair->key->str == key || memcmp(pair->key->str, key, key_len) == 0);
 }
 
-static void insert_to_bucket(hashtable_t *hashtable, bucket_t *bucket, list_t *list) {
-    if (bucket_is_empty(hashtable, bucket)) {
-        list_insert(&hashtable->list, list);
-        bucket->first = bucket->last = list;
-    } else {
-        list_insert(bucket->first, list);
-        bucket->first = list;
+/* Returns the slot holding the key, or the free slot where it would go */
+static size_t hashtable_find_slot(hashtable_t *hashtable, const char *key,
+                                  size_t key_len, size_t hash) {
+    size_t mask = hashmask(hashtable->order);
+    size_t index = hash & mask;
+    slot_t *slot;
+
+    while (1) {
+        slot = &hashtable->slots[index];
+        if (!slot->pair)
+            return index;
+
+        if (slot->hash == hash && pair_matches(slot->pair, key, key_len, hash))
+            return index;
+
+        index = (index + 1) & mask;
     }
 }
 
-static pair_t *hashtable_find_pair(hashtable_t *hashtable, bucket_t *bucket,
-                                   const char *key, size_t key_len, size_t hash) {
+static pair_t *hashtable_find_pair(hashtable_t *hashtable, const char *key,
+                                   size_t key_len, size_t hash) {
     list_t *list;
     pair_t *pair;
 
-    if (bucket_is_empty(hashtable, bucket))
-        return NULL;
+    if (hashtable->slots)
+        return hashtable->slots[hashtable_find_slot(hashtable, key, key_len, hash)].pair;
 
-    list = bucket->first;
-    while (1) {
-        pair = list_to_pair(list);
-        if (pair->hash == hash && pair->key_len == key_len &&
-            memcmp(pair->key, key, key_len) == 0)
+    for (list = hashtable->ordered_list.next; list != &hashtable->ordered_list;
+         list = list->next) {
+        pair = ordered_list_to_pair(list);
+        if (pair_matches(pair, key, key_len, hash))
             return pair;
+    }
 
-        if (list == bucket->last)
+    return NULL;
+}
+
+/* Backward shift deletion: move later entries of the probe sequence
+   into the hole so that lookups never need tombstones */
+static void hashtable_remove_slot(hashtable_t *hashtable, size_t index) {
+    size_t mask = hashmask(hashtable->order);
+    size_t next = index, home;
+
+    while (1) {
+        next = (next + 1) & mask;
+        if (!hashtable->slots[next].pair)
             break;
 
-        list = list->next;
+        home = hashtable->slots[next].hash & mask;
+        if (((next - home) & mask) >= ((next - index) & mask)) {
+            hashtable->slots[index] = hashtable->slots[next];
+            index = next;
+        }
     }
 
-    return NULL;
+    hashtable->slots[index].pair = NULL;
+}
+
+static void free_pair(hashtable_t *hashtable, pair_t *pair) {
+    if (pair->key != &pair->inline_key)
+        jsonp_key_decref(pair->key);
+
+    jsonp_node_free(hashtable->arena, pair);
 }
 
 /* returns 0 on success, -1 if key was not found */
 static int hashtable_do_del(hashtable_t *hashtable, const char *key, size_t key_len,
                             size_t hash) {
     pair_t *pair;
-    bucket_t *bucket;
     size_t index;
 
-    index = hash & hashmask(hashtable->order);
-    bucket = &hashtable->buckets[index];
-
-    pair = hashtable_find_pair(hashtable, bucket, key, key_len, hash);
-    if (!pair)
-        return -1;
-
-    if (&pair->list == bucket->first && &pair->list == bucket->last)
-        bucket->first = bucket->last = &hashtable->list;
-
-    else if (&pair->list == bucket->first)
-        bucket->first = pair->list.next;
+    if (hashtable->slots) {
+        index = hashtable_find_slot(hashtable, key, key_len, hash);
+        pair = hashtable->slots[index].pair;
+        if (!pair)
+            return -1;
 
-    else if (&pair->list == bucket->last)
-        bucket->last = pair->list.prev;
+        hashtable_remove_slot(hashtable, index);
+    } else {
+        pair = hashtable_find_pair(hashtable, key, key_len, hash);
+        if (!pair)
+            return -1;
+    }
 
-    list_remove(&pair->list);
     list_remove(&pair->ordered_list);
     json_decref(pair->value);
 
-    jsonp_free(pair);
+    free_pair(hashtable, pair);
     hashtable->size--;
 
     return 0;
@@ -129,143 +159,176 @@ static void hashtable_do_clear(hashtable_t *hashtable) {
     list_t *list, *next;
     pair_t *pair;
 
-    for (list = hashtable->list.next; list != &hashtable->list; list = next) {
+    for (list = hashtable->ordered_list.next; list != &hashtable->ordered_list;
+         list = next) {
         next = list->next;
-        pair = list_to_pair(list);
+        pair = ordered_list_to_pair(list);
         json_decref(pair->value);
-        jsonp_free(pair);
+        free_pair(hashtable, pair);
     }
 }
 
+/* Grows the slot array, or creates it when a small object outgrows
+   HASHTABLE_SMALL_MAX */
 static int hashtable_do_rehash(hashtable_t *hashtable) {
-    list_t *list, *next;
+    list_t *list;
     pair_t *pair;
-    size_t i, index, new_size, new_order;
-    struct hashtable_bucket *new_buckets;
+    size_t index, mask, new_order;
+    slot_t *new_slots;
 
-    new_order = hashtable->order + 1;
-    new_size = hashsize(new_order);
+    new_order = hashtable->slots ? hashtable->order + 1 : INITIAL_HASHTABLE_ORDER;
+    while ((hashtable->size + 1) * 4 > hashsize(new_order) * 3)
+        new_order++;
 
-    new_buckets = jsonp_malloc(new_size * sizeof(bucket_t));
-    if (!new_buckets)
+    new_slots = jsonp_node_malloc(hashtable->arena, hashsize(new_order) * sizeof(slot_t));
+    if (!new_slots)
         return -1;
 
-    jsonp_free(hashtable->buckets);
-    hashtable->buckets = new_buckets;
+    memset(new_slots, 0, hashsize(new_order) * sizeof(slot_t));
+    jsonp_node_free(hashtable->arena, hashtable->slots);
+    hashtable->slots = new_slots;
     hashtable->order = new_order;
+    mask = hashmask(new_order);
 
-    for (i = 0; i < hashsize(hashtable->order); i++) {
-        hashtable->buckets[i].first = hashtable->buckets[i].last = &hashtable->list;
-    }
-
-    list = hashtable->list.next;
-    list_init(&hashtable->list);
+    for (list = hashtable->ordered_list.next; list != &hashtable->ordered_list;
+         list = list->next) {
+        pair = ordered_list_to_pair(list);
+        index = pair->key->hash & mask;
+        while (new_slots[index].pair)
+            index = (index + 1) & mask;
 
-    for (; list != &hashtable->list; list = next) {
-        next = list->next;
-        pair = list_to_pair(list);
-        index = pair->hash % new_size;
-        insert_to_bucket(hashtable, &hashtable->buckets[index], &pair->list);
+        new_slots[index].hash = pair->key->hash;
+        new_slots[index].pair = pair;
     }
 
     return 0;
 }
 
-int hashtable_init(hashtable_t *hashtable) {
-    size_t i;
+int hashtable_init(hashtable_t *hashtable) { return hashtable_init_arena(hashtable, NULL); }
 
+int hashtable_init_arena(hashtable_t *hashtable, json_arena_t *arena) {
     hashtable->size = 0;
-    hashtable->order = INITIAL_HASHTABLE_ORDER;
-    hashtable->buckets = jsonp_malloc(hashsize(hashtable->order) * sizeof(bucket_t));
-    if (!hashtable->buckets)
-        return -1;
-
-    list_init(&hashtable->list);
+    hashtable->slots = NULL;
+    hashtable->order = 0;
+    hashtable->arena = arena;
     list_init(&hashtable->ordered_list);
 
-    for (i = 0; i < hashsize(hashtable->order); i++) {
-        hashtable->buckets[i].first = hashtable->buckets[i].last = &hashtable->list;
-    }
-
     return 0;
 }
 
 void hashtable_close(hashtable_t *hashtable) {
     hashtable_do_clear(hashtable);
-    jsonp_free(hashtable->buckets);
+    jsonp_node_free(hashtable->arena, hashtable->slots);
 }
 
-static pair_t *init_pair(json_t *value, const char *key, size_t key_len, size_t hash) {
+static pair_t *init_pair(hashtable_t *hashtable, json_t *value, const char *key,
+                         size_t key_len, size_t hash) {
     pair_t *pair;
 
     /* offsetof(...) returns the size of pair_t without the last,
    flexible member. This way, the correct amount is
    allocated. */
 
-    if (key_len >= (size_t)-1 - offsetof(pair_t, key)) {
+    if (key_len >= JSON_KEY_MAX_LEN) {
         /* Avoid an overflow if the key is very long */
         return NULL;
     }
 
-    pair = jsonp_malloc(offsetof(pair_t, key) + key_len + 1);
+    pair = jsonp_node_malloc(hashtable->arena, offsetof(pair_t, inline_key.str) + key_len + 1);
 
     if (!pair)
         return NULL;
 
-    pair->hash = hash;
-    memcpy(pair->key, key, key_len);
-    pair->key[key_len] = '\0';
-    pair->key_len = key_len;
+    pair->key = &pair->inline_key;
+    pair->inline_key.refcount = JSON_KEY_INLINE;
+    pair->inline_key.hash = hash;
+    memcpy(pair->inline_key.str, key, key_len);
+    pair->inline_key.str[key_len] = '\0';
+    pair->inline_key.len = (uint32_t)key_len;
     pair->value = value;
 
-    list_init(&pair->list);
     list_init(&pair->ordered_list);
 
     return pair;
 }
 
-int hashtable_set(hashtable_t *hashtable, const char *key, size_t key_len,
-                  json_t *value) {
+static pair_t *init_pair_interned(hashtable_t *hashtable, json_t *value, json_key_t *key) {
     pair_t *pair;
-    bucket_t *bucket;
-    size_t hash, index;
 
-    /* rehash if the load ratio exceeds 1 */
-    if (hashtable->size >= hashsize(hashtable->order))
+    /* The pair ends before its unused inline key */
+    pair = jsonp_node_malloc(hashtable->arena, offsetof(pair_t, inline_key));
+    if (!pair)
+        return NULL;
+
+    jsonp_key_incref(key);
+    pair->key = key;
+    pair->value = value;
+
+    list_init(&pair->ordered_list);
+
+    return pair;
+}
+
+static int hashtable_do_set(hashtable_t *hashtable, const char *key, size_t key_len,
+                            size_t hash, json_key_t *interned, json_t *value) {
+    pair_t *pair;
+    size_t index = 0;
+
+    /* keep the load factor of the slot array at most 3/4 */
+    if (hashtable->slots && (hashtable->size + 1) * 4 > hashsize(hashtable->order) * 3)
         if (hashtable_do_rehash(hashtable))
             return -1;
 
-    hash = hash_str(key, key_len);
-    index = hash & hashmask(hashtable->order);
-    bucket = &hashtable->buckets[index];
-    pair = hashtable_find_pair(hashtable, bucket, key, key_len, hash);
+    if (hashtable->slots) {
+        index = hashtable_find_slot(hashtable, key, key_len, hash);
+        pair = hashtable->slots[index].pair;
+    } else {
+        pair = hashtable_find_pair(hashtable, key, key_len, hash);
+    }
 
     if (pair) {
         json_decref(pair->value);
         pair->value = value;
-    } else {
-        pair = init_pair(value, key, key_len, hash);
+        return 0;
+    }
 
-        if (!pair)
+    if (!hashtable->slots && hashtable->size >= HASHTABLE_SMALL_MAX) {
+        if (hashtable_do_rehash(hashtable))
             return -1;
+        index = hashtable_find_slot(hashtable, key, key_len, hash);
+    }
+
+    if (interned)
+        pair = init_pair_interned(hashtable, value, interned);
+    else
+        pair = init_pair(hashtable, value, key, key_len, hash);
 
-        insert_to_bucket(hashtable, bucket, &pair->list);
-        list_insert(&hashtable->ordered_list, &pair->ordered_list);
+    if (!pair)
+        return -1;
 
-        hashtable->size++;
+    if (hashtable->slots) {
+        hashtable->slots[index].hash = hash;
+        hashtable->slots[index].pair = pair;
     }
+    list_insert(&hashtable->ordered_list, &pair->ordered_list);
+
+    hashtable->size++;
     return 0;
 }
 
+int hashtable_set(hashtable_t *hashtable, const char *key, size_t key_len,
+                  json_t *value) {
+    return hashtable_do_set(hashtable, key, key_len, hash_str(key, key_len), NULL, value);
+}
+
+int hashtable_set_key(hashtable_t *hashtable, json_key_t *key, json_t *value) {
+    return hashtable_do_set(hashtable, key->str, key->len, key->hash, key, value);
+}
+
 void *hashtable_get(hashtable_t *hashtable, const char *key, size_t key_len) {
     pair_t *pair;
-    size_t hash;
-    bucket_t *bucket;
 
-    hash = hash_str(key, key_len);
-    bucket = &hashtable->buckets[hash & hashmask(hashtable->order)];
-
-    pair = hashtable_find_pair(hashtable, bucket, key, key_len, hash);
+    pair = hashtable_find_pair(hashtable, key, key_len, hash_str(key, key_len));
     if (!pair)
         return NULL;
 
@@ -278,15 +341,12 @@ int hashtable_del(hashtable_t *hashtable, const char *key, size_t key_len) {
 }
 
 void hashtable_clear(hashtable_t *hashtable) {
-    size_t i;
-
     hashtable_do_clear(hashtable);
 
-    for (i = 0; i < hashsize(hashtable->order); i++) {
-        hashtable->buckets[i].first = hashtable->buckets[i].last = &hashtable->list;
-    }
+    jsonp_node_free(hashtable->arena, hashtable->slots);
+    hashtable->slots = NULL;
+    hashtable->order = 0;
 
-    list_init(&hashtable->list);
     list_init(&hashtable->ordered_list);
     hashtable->size = 0;
 }
@@ -297,13 +357,18 @@ void *hashtable_iter(hashtable_t *hashtable) {
 
 void *hashtable_iter_at(hashtable_t *hashtable, const char *key, size_t key_len) {
     pair_t *pair;
-    size_t hash;
-    bucket_t *bucket;
 
-    hash = hash_str(key, key_len);
-    bucket = &hashtable->buckets[hash & hashmask(hashtable->order)];
+    pair = hashtable_find_pair(hashtable, key, key_len, hash_str(key, key_len));
+    if (!pair)
+        return NULL;
 
-    pair = hashtable_find_pair(hashtable, bucket, key, key_len, hash);
+    return &pair->ordered_list;
+}
+
+void *hashtable_iter_at_key(hashtable_t *hashtable, json_key_t *key) {
+    pair_t *pair;
+
+    pair = hashtable_find_pair(hashtable, key->str, key->len, key->hash);
     if (!pair)
         return NULL;
 
@@ -319,12 +384,12 @@ void *hashtable_iter_next(hashtable_t *hashtable, void *iter) {
 
 void *hashtable_iter_key(void *iter) {
     pair_t *pair = ordered_list_to_pair((list_t *)iter);
-    return pair->key;
+    return pair->key->str;
 }
 
 size_t hashtable_iter_key_len(void *iter) {
     pair_t *pair = ordered_list_to_pair((list_t *)iter);
-    return pair->key_len;
+    return pair->key->len;
 }
 
 void *hashtable_iter_value(void *iter) {
@@ -332,9 +397,146 @@ void *hashtable_iter_value(void *iter) {
     return pair->value;
 }
 
+json_key_t *hashtable_iter_interned_key(void *iter) {
+    pair_t *pair = ordered_list_to_pair((list_t *)iter);
+    return pair->key == &pair->inline_key ? NULL : pair->key;
+}
+
 void hashtable_iter_set(void *iter, json_t *value) {
     pair_t *pair = ordered_list_to_pair((list_t *)iter);
 
     json_decref(pair->value);
     pair->value = value;
 }
+
+/*** interned keys ***/
+
+#define KEY_TABLE_INITIAL_SIZE 64
+
+json_key_t *jsonp_key_create(const char *key, size_t key_len) {
+    json_key_t *result;
+
+    if (key_len >= JSON_KEY_MAX_LEN)
+        return NULL;
+
+    result = jsonp_malloc(offsetof(json_key_t, str) + key_len + 1);
+    if (!result)
+        return NULL;
+
+    result->refcount = 1;
+    result->hash = hash_str(key, key_len);
+    result->len = (uint32_t)key_len;
+    memcpy(result->str, key, key_len);
+    result->str[key_len] = '\0';
+    return result;
+}
+
+void jsonp_key_incref(json_key_t *key) { JSON_INTERNAL_INCREF(key); }
+
+void jsonp_key_decref(json_key_t *key) {
+    if (JSON_INTERNAL_DECREF(key) == 0)
+        jsonp_free(key);
+}
+
+int key_table_init(key_table_t *table) {
+    table->size = KEY_TABLE_INITIAL_SIZE;
+    table->count = 0;
+    table->root = NULL;
+    table->buckets = jsonp_malloc(table->size * sizeof(key_table_entry_t *));
+    if (!table->buckets)
+        return -1;
+
+    memset(table->buckets, 0, table->size * sizeof(key_table_entry_t *));
+    return 0;
+}
+
+void key_table_close(key_table_t *table) {
+    key_table_entry_t *entry, *next;
+    size_t i;
+
+    for (i = 0; i < table->size; i++) {
+        for (entry = table->buckets[i]; entry; entry = next) {
+            next = entry->next;
+            jsonp_key_decref(entry->key);
+            jsonp_free(entry);
+        }
+    }
+    jsonp_free(table->buckets);
+}
+
+static int key_table_grow(key_table_t *table) {
+    key_table_entry_t **buckets, *entry, *next;
+    size_t i, size = table->size * 2;
+
+    buckets = jsonp_malloc(size * sizeof(key_table_entry_t *));
+    if (!buckets)
+        return -1;
+
+    memset(buckets, 0, size * sizeof(key_table_entry_t *));
+    for (i = 0; i < table->size; i++) {
+        for (entry = table->buckets[i]; entry; entry = next) {
+            next = entry->next;
+            entry->next = buckets[entry->key->hash & (size - 1)];
+            buckets[entry->key->hash & (size - 1)] = entry;
+        }
+    }
+
+    jsonp_free(table->buckets);
+    table->buckets = buckets;
+    table->size = size;
+    return 0;
+}
+
+static key_table_entry_t *key_table_lookup(key_table_t *table, const char *key,
+                                           size_t key_len) {
+    key_table_entry_t *entry;
+    size_t hash = hash_str(key, key_len);
+
+    for (entry = table->buckets[hash & (table->size - 1)]; entry; entry = entry->next) {
+        if (entry->key->hash == hash && entry->key->len == key_len &&
+            memcmp(entry->key->str, key, key_len) == 0)
+            return entry;
+    }
+
+    if (table->count >= table->size && key_table_grow(table))
+        return NULL;
+
+    entry = jsonp_malloc(sizeof(key_table_entry_t));
+    if (!entry)
+        return NULL;
+
+    entry->key = jsonp_key_create(key, key_len);
+    if (!entry->key) {
+        jsonp_free(entry);
+        return NULL;
+    }
+
+    entry->successor = entry->child = NULL;
+    entry->next = table->buckets[hash & (table->size - 1)];
+    table->buckets[hash & (table->size - 1)] = entry;
+    table->count++;
+    return entry;
+}
+
+key_table_entry_t *key_table_intern(key_table_t *table, key_table_entry_t *parent,
+                                    key_table_entry_t *previous, const char *key,
+                                    size_t key_len) {
+    key_table_entry_t **hint, *entry;
+
+    if (previous)
+        hint = &previous->successor;
+    else if (parent)
+        hint = &parent->child;
+    else
+        hint = &table->root;
+
+    entry = *hint;
+    if (entry && entry->key->len == key_len && memcmp(entry->key->str, key, key_len) == 0)
+        return entry;
+
+    entry = key_table_lookup(table, key, key_len);
+    if (entry)
+        *hint = entry;
+
+    return entry;
+}
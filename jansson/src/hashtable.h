@@ -8,41 +8,69 @@
 #ifndef HASHTABLE_H
 #define HASHTABLE_H
 
+#ifdef HAVE_CONFIG_H
+#include <jansson_private_config.h>
+#endif
+
 #include "jansson.h"
 #include <stdlib.h>
 
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
 struct hashtable_list {
     struct hashtable_list *prev;
     struct hashtable_list *next;
 };
 
+/* An object key with its hash. Interned keys are shared by every pair
+   that uses them and counted, other keys live inside their pair. */
+struct json_key {
+    volatile uint32_t refcount; /* JSON_KEY_INLINE for keys stored in a pair */
+    uint32_t len;
+    size_t hash;
+    char str[1];
+};
+
+#define JSON_KEY_INLINE   ((uint32_t)-1)
+#define JSON_KEY_MAX_LEN  ((size_t)(uint32_t)-1)
+
 /* "pair" may be a bit confusing a name, but think of it as a
    key-value pair. In this case, it just encodes some extra data,
-   too */
+   too. Pairs stay at the same address while they are in the table,
+   iterators point to their ordered_list. */
 struct hashtable_pair {
-    struct hashtable_list list;
     struct hashtable_list ordered_list;
-    size_t hash;
     json_t *value;
-    size_t key_len;
-    char key[1];
+    json_key_t *key; /* &inline_key unless the key is interned */
+    json_key_t inline_key; /* must be last, the string extends past it */
 };
 
-struct hashtable_bucket {
-    struct hashtable_list *first;
-    struct hashtable_list *last;
+/* Open addressing slot, the hash is cached to avoid touching the pair
+   while probing */
+struct hashtable_slot {
+    size_t hash;
+    struct hashtable_pair *pair; /* NULL if the slot is free */
 };
 
+/* Objects with at most this many keys have no slot array and are
+   searched linearly in insertion order */
+#define HASHTABLE_SMALL_MAX 8
+
 typedef struct hashtable {
     size_t size;
-    struct hashtable_bucket *buckets;
-    size_t order; /* hashtable has pow(2, order) buckets */
-    struct hashtable_list list;
+    struct hashtable_slot *slots; /* NULL for small objects */
+    size_t order; /* slots has pow(2, order) entries */
     struct hashtable_list ordered_list;
+    json_arena_t *arena; /* storage comes from this arena, see jsonp_node_malloc */
 } hashtable_t;
 
+/* Only valid for keys stored in their pair, not for interned keys */
 #define hashtable_key_to_iter(key_)                                                      \
-    (&(container_of(key_, struct hashtable_pair, key)->ordered_list))
+    (&(container_of(container_of(key_, json_key_t, str), struct hashtable_pair,          \
+                    inline_key)                                                          \
+           ->ordered_list))
 
 /**
  * hashtable_init - Initialize a hashtable object
@@ -51,11 +79,22 @@ typedef struct hashtable {
  *
  * Initializes a statically allocated hashtable object. The object
  * should be cleared with hashtable_close when it's no longer used.
+ * Nothing is allocated until the object grows past
+ * HASHTABLE_SMALL_MAX keys.
  *
  * Returns 0 on success, -1 on error (out of memory).
  */
 int hashtable_init(hashtable_t *hashtable) JANSSON_ATTRS((warn_unused_result));
 
+/**
+ * hashtable_init_arena - Initialize a hashtable object in an arena
+ *
+ * Like hashtable_init(), but slots and pairs are allocated with
+ * jsonp_node_malloc() from @arena, which may be NULL.
+ */
+int hashtable_init_arena(hashtable_t *hashtable, json_arena_t *arena)
+    JANSSON_ATTRS((warn_unused_result));
+
 /**
  * hashtable_close - Release all resources used by a hashtable object
  *
@@ -83,6 +122,14 @@ void hashtable_close(hashtable_t *hashtable);
  */
 int hashtable_set(hashtable_t *hashtable, const char *key, size_t key_len, json_t *value);
 
+/**
+ * hashtable_set_key - Add/modify value in hashtable using an interned key
+ *
+ * Like hashtable_set(), but the hash stored in @key is used and a new
+ * pair takes a reference to @key instead of copying it.
+ */
+int hashtable_set_key(hashtable_t *hashtable, json_key_t *key, json_t *value);
+
 /**
  * hashtable_get - Get a value associated with a key
  *
@@ -143,6 +190,13 @@ void *hashtable_iter(hashtable_t *hashtable);
  */
 void *hashtable_iter_at(hashtable_t *hashtable, const char *key, size_t key_len);
 
+/**
+ * hashtable_iter_at_key - Return an iterator at a specific interned key
+ *
+ * Like hashtable_iter_at(), using the hash stored in @key.
+ */
+void *hashtable_iter_at_key(hashtable_t *hashtable, json_key_t *key);
+
 /**
  * hashtable_iter_next - Advance an iterator
  *
@@ -175,6 +229,13 @@ size_t hashtable_iter_key_len(void *iter);
  */
 void *hashtable_iter_value(void *iter);
 
+/**
+ * hashtable_iter_interned_key - Retrieve the interned key pointed by an iterator
+ *
+ * Returns NULL if the key is stored in the pair.
+ */
+json_key_t *hashtable_iter_interned_key(void *iter);
+
 /**
  * hashtable_iter_set - Set the value pointed by an iterator
  *
@@ -183,4 +244,43 @@ void *hashtable_iter_value(void *iter);
  */
 void hashtable_iter_set(void *iter, json_t *value);
 
+/* Keys interned while decoding or packing a document. Besides the usual
+   hash lookup, each entry remembers the key that followed it in the last
+   object and the first key of objects nested under it, so arrays of
+   objects with the same layout find their keys without hashing. */
+typedef struct key_table_entry {
+    json_key_t *key;
+    struct key_table_entry *next;      /* bucket chain */
+    struct key_table_entry *successor; /* next key in the last object */
+    struct key_table_entry *child;     /* first key of the last nested object */
+} key_table_entry_t;
+
+typedef struct key_table {
+    key_table_entry_t **buckets;
+    size_t size; /* number of buckets, a power of 2 */
+    size_t count;
+    key_table_entry_t *root; /* first key of the last top-level object */
+} key_table_t;
+
+int key_table_init(key_table_t *table) JANSSON_ATTRS((warn_unused_result));
+
+void key_table_close(key_table_t *table);
+
+/**
+ * key_table_intern - Find or add a key
+ *
+ * @parent: Entry of the key whose value contains the object, or NULL
+ * @previous: Entry of the preceding key in the same object, or NULL
+ *
+ * Returns the entry, owned by the table, or NULL on allocation failure.
+ */
+key_table_entry_t *key_table_intern(key_table_t *table, key_table_entry_t *parent,
+                                    key_table_entry_t *previous, const char *key,
+                                    size_t key_len);
+
+/* Reference counting for interned keys */
+json_key_t *jsonp_key_create(const char *key, size_t key_len);
+void jsonp_key_incref(json_key_t *key);
+void jsonp_key_decref(json_key_t *key);
+
 #endif
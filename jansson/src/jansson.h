@@ -58,9 +58,13 @@ typedef enum {
     JSON_NULL
 } json_type;
 
+typedef struct json_arena json_arena_t;
+typedef struct json_key json_key_t;
+
 typedef struct json_t {
     json_type type;
     volatile size_t refcount;
+    json_arena_t *arena; /* owning arena of a JSON_DECODE_ARENA document, or NULL */
 } json_t;
 
 #ifndef JANSSON_USING_CMAKE /* disabled if using cmake */
@@ -204,41 +208,54 @@ int json_object_update_missing(json_t *object, json_t *other);
 int json_object_update_recursive(json_t *object, json_t *other);
 void *json_object_iter(json_t *object);
 void *json_object_iter_at(json_t *object, const char *key);
-void *json_object_key_to_iter(const char *key);
+void *json_object_key_to_iter(const char *key); /* NULL for interned keys */
+void *json_object_iter_for_key(json_t *object, const char *key);
 void *json_object_iter_next(json_t *object, void *iter);
 const char *json_object_iter_key(void *iter);
 size_t json_object_iter_key_len(void *iter);
 json_t *json_object_iter_value(void *iter);
 int json_object_iter_set_new(json_t *object, void *iter, json_t *value);
 
+/* Interned keys are shared by objects and carry their hash. Objects decoded
+   with JSON_DECODE_INTERN_KEYS use them, json_key() creates one for building
+   many objects with the same keys. */
+json_key_t *json_key(const char *key) JANSSON_ATTRS((warn_unused_result));
+json_key_t *json_keyn(const char *key, size_t key_len) JANSSON_ATTRS((warn_unused_result));
+void json_key_decref(json_key_t *key);
+int json_object_set_key_new(json_t *object, json_key_t *key, json_t *value);
+
 #define json_object_foreach(object, key, value)                                          \
     for (key = json_object_iter_key(json_object_iter(object));                           \
-         key && (value = json_object_iter_value(json_object_key_to_iter(key)));          \
+         key &&                                                                          \
+         (value = json_object_iter_value(json_object_iter_for_key(object, key)));        \
          key = json_object_iter_key(                                                     \
-             json_object_iter_next(object, json_object_key_to_iter(key))))
+             json_object_iter_next(object, json_object_iter_for_key(object, key))))
 
 #define json_object_keylen_foreach(object, key, key_len, value)                          \
     for (key = json_object_iter_key(json_object_iter(object)),                           \
-        key_len = json_object_iter_key_len(json_object_key_to_iter(key));                \
-         key && (value = json_object_iter_value(json_object_key_to_iter(key)));          \
+        key_len = json_object_iter_key_len(json_object_iter_for_key(object, key));       \
+         key &&                                                                          \
+         (value = json_object_iter_value(json_object_iter_for_key(object, key)));        \
          key = json_object_iter_key(                                                     \
-             json_object_iter_next(object, json_object_key_to_iter(key))),               \
-        key_len = json_object_iter_key_len(json_object_key_to_iter(key)))
+             json_object_iter_next(object, json_object_iter_for_key(object, key))),      \
+        key_len = json_object_iter_key_len(json_object_iter_for_key(object, key)))
 
 #define json_object_foreach_safe(object, n, key, value)                                  \
     for (key = json_object_iter_key(json_object_iter(object)),                           \
-        n = json_object_iter_next(object, json_object_key_to_iter(key));                 \
-         key && (value = json_object_iter_value(json_object_key_to_iter(key)));          \
+        n = json_object_iter_next(object, json_object_iter_for_key(object, key));        \
+         key &&                                                                          \
+         (value = json_object_iter_value(json_object_iter_for_key(object, key)));        \
          key = json_object_iter_key(n),                                                  \
-        n = json_object_iter_next(object, json_object_key_to_iter(key)))
+        n = json_object_iter_next(object, json_object_iter_for_key(object, key)))
 
 #define json_object_keylen_foreach_safe(object, n, key, key_len, value)                  \
     for (key = json_object_iter_key(json_object_iter(object)),                           \
-        n = json_object_iter_next(object, json_object_key_to_iter(key)),                 \
-        key_len = json_object_iter_key_len(json_object_key_to_iter(key));                \
-         key && (value = json_object_iter_value(json_object_key_to_iter(key)));          \
+        n = json_object_iter_next(object, json_object_iter_for_key(object, key)),        \
+        key_len = json_object_iter_key_len(json_object_iter_for_key(object, key));       \
+         key &&                                                                          \
+         (value = json_object_iter_value(json_object_iter_for_key(object, key)));        \
          key = json_object_iter_key(n), key_len = json_object_iter_key_len(n),           \
-        n = json_object_iter_next(object, json_object_key_to_iter(key)))
+        n = json_object_iter_next(object, json_object_iter_for_key(object, key)))
 
 #define json_array_foreach(array, index, value)                                          \
     for (index = 0;                                                                      \
@@ -264,6 +281,11 @@ static JSON_INLINE int json_object_setn_nocheck(json_t *object, const char *key,
     return json_object_setn_new_nocheck(object, key, key_len, json_incref(value));
 }
 
+static JSON_INLINE int json_object_set_key(json_t *object, json_key_t *key,
+                                           json_t *value) {
+    return json_object_set_key_new(object, key, json_incref(value));
+}
+
 static JSON_INLINE int json_object_iter_set(json_t *object, void *iter, json_t *value) {
     return json_object_iter_set_new(object, iter, json_incref(value));
 }
@@ -360,6 +382,12 @@ json_t *json_deep_copy(const json_t *value) JANSSON_ATTRS((warn_unused_result));
 #define JSON_DECODE_ANY         0x4
 #define JSON_DECODE_INT_AS_REAL 0x8
 #define JSON_ALLOW_NUL          0x10
+#define JSON_DECODE_ARENA       0x20
+#define JSON_DECODE_INTERN_KEYS 0x40
+
+/* Converts number text in JSON syntax to a double without depending on the
+   locale. Returns -1 and an infinity on overflow. */
+int json_strtod(const char *str, size_t len, double *out);
 
 typedef size_t (*json_load_callback_t)(void *buffer, size_t buflen, void *data);
 
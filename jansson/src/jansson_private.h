@@ -88,12 +88,33 @@ char *jsonp_strndup(const char *str, size_t length) JANSSON_ATTRS((warn_unused_r
 char *jsonp_strdup(const char *str) JANSSON_ATTRS((warn_unused_result));
 char *jsonp_strndup(const char *str, size_t len) JANSSON_ATTRS((warn_unused_result));
 
+/* Arenas for JSON_DECODE_ARENA documents. While an arena is installed on the
+   current thread, new values and their storage are carved out of it. Every value
+   holds a reference to its arena and storage allocated later (when the document
+   is modified) comes from the heap, so the node functions below take the arena
+   of the value that owns the memory. */
+json_arena_t *jsonp_arena_create(void);
+void jsonp_arena_incref(json_arena_t *arena);
+void jsonp_arena_decref(json_arena_t *arena);
+json_arena_t *jsonp_arena_install(json_arena_t *arena);
+json_arena_t *jsonp_arena_current(void);
+void *jsonp_node_malloc(json_arena_t *arena, size_t size) JANSSON_ATTRS((warn_unused_result));
+void jsonp_node_free(json_arena_t *arena, void *ptr);
+char *jsonp_node_strndup(json_arena_t *arena, const char *str, size_t len)
+    JANSSON_ATTRS((warn_unused_result));
+
 /* Circular reference check*/
 /* Space for "0x", double the sizeof a pointer for the hex and a terminator. */
 #define LOOP_KEY_LEN (2 + (sizeof(json_t *) * 2) + 1)
 int jsonp_loop_check(hashtable_t *parents, const json_t *json, char *key, size_t key_size,
                      size_t *key_len_out);
 
+#if defined(_MSC_VER)
+#define JSON_THREAD_LOCAL __declspec(thread)
+#else
+#define JSON_THREAD_LOCAL __thread
+#endif
+
 /* Windows compatibility */
 #if defined(_WIN32) || defined(WIN32)
 #if defined(_MSC_VER) /* MS compiller */
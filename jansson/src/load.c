@@ -67,6 +67,8 @@ typedef struct {
     strbuffer_t saved_text;
     size_t flags;
     size_t depth;
+    key_table_t *keys;              /* JSON_DECODE_INTERN_KEYS */
+    key_table_entry_t *key_parent; /* key of the object being parsed */
     int token;
     union {
         struct {
@@ -660,6 +662,7 @@ static void lex_close(lex_t *lex) {
 static json_t *parse_value(lex_t *lex, size_t flags, json_error_t *error);
 
 static json_t *parse_object(lex_t *lex, size_t flags, json_error_t *error) {
+    key_table_entry_t *parent = lex->key_parent, *previous = NULL, *entry = NULL;
     json_t *object = json_object();
     if (!object)
         return NULL;
@@ -703,14 +706,27 @@ static json_t *parse_object(lex_t *lex, size_t flags, json_error_t *error) {
             goto error;
         }
 
+        if (lex->keys) {
+            entry = key_table_intern(lex->keys, parent, previous, key, len);
+            if (!entry) {
+                jsonp_free(key);
+                error_set(error, lex, json_error_out_of_memory, "out of memory");
+                goto error;
+            }
+            previous = entry;
+        }
+
         lex_scan(lex, error);
+        lex->key_parent = entry;
         value = parse_value(lex, flags, error);
+        lex->key_parent = parent;
         if (!value) {
             jsonp_free(key);
             goto error;
         }
 
-        if (json_object_setn_new_nocheck(object, key, len, value)) {
+        if (entry ? json_object_set_key_new(object, entry->key, value)
+                  : json_object_setn_new_nocheck(object, key, len, value)) {
             jsonp_free(key);
             goto error;
         }
@@ -847,7 +863,7 @@ static json_t *parse_value(lex_t *lex, size_t flags, json_error_t *error) {
     return json;
 }
 
-static json_t *parse_json(lex_t *lex, size_t flags, json_error_t *error) {
+static json_t *parse_json_value(lex_t *lex, size_t flags, json_error_t *error) {
     json_t *result;
 
     lex->depth = 0;
@@ -882,6 +898,47 @@ static json_t *parse_json(lex_t *lex, size_t flags, json_error_t *error) {
     return result;
 }
 
+static json_t *parse_json(lex_t *lex, size_t flags, json_error_t *error) {
+    json_arena_t *arena = NULL, *previous = NULL;
+    key_table_t keys;
+    json_t *result;
+
+    lex->keys = NULL;
+    lex->key_parent = NULL;
+
+    if (flags & JSON_DECODE_INTERN_KEYS) {
+        if (key_table_init(&keys)) {
+            error_set(error, NULL, json_error_out_of_memory, "out of memory");
+            return NULL;
+        }
+        lex->keys = &keys;
+    }
+
+    if (flags & JSON_DECODE_ARENA) {
+        arena = jsonp_arena_create();
+        if (!arena) {
+            if (lex->keys)
+                key_table_close(lex->keys);
+            error_set(error, NULL, json_error_out_of_memory, "out of memory");
+            return NULL;
+        }
+        previous = jsonp_arena_install(arena);
+    }
+
+    result = parse_json_value(lex, flags, error);
+
+    /* Values keep the arena and their keys alive, drop the references held
+       while parsing */
+    if (arena) {
+        jsonp_arena_install(previous);
+        jsonp_arena_decref(arena);
+    }
+    if (lex->keys)
+        key_table_close(lex->keys);
+
+    return result;
+}
+
 typedef struct {
     const char *data;
     size_t pos;
@@ -59,3 +59,156 @@ void json_get_alloc_funcs(json_malloc_t *malloc_fn, json_free_t *free_fn) {
     if (free_fn)
         *free_fn = do_free;
 }
+
+/*** arenas ***/
+
+#define ARENA_ALIGN           8
+#define ARENA_ALIGN_UP(size)  (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_MIN_BLOCK       4096
+#define ARENA_MAX_BLOCK       (1024 * 1024)
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+} arena_block_t;
+
+#define ARENA_HEADER           ARENA_ALIGN_UP(sizeof(arena_block_t))
+#define arena_block_data(block) ((char *)(block) + ARENA_HEADER)
+
+struct json_arena {
+    arena_block_t *blocks; /* the first block is the one being filled */
+    size_t next_size;
+    volatile size_t refcount;
+    int heap_mixed; /* a value in the arena owns heap memory */
+};
+
+static JSON_THREAD_LOCAL json_arena_t *current_arena = NULL;
+
+json_arena_t *jsonp_arena_create(void) {
+    json_arena_t *arena = jsonp_malloc(sizeof(json_arena_t));
+    if (!arena)
+        return NULL;
+
+    arena->blocks = NULL;
+    arena->next_size = ARENA_MIN_BLOCK;
+    arena->refcount = 1;
+    arena->heap_mixed = 0;
+    return arena;
+}
+
+void jsonp_arena_incref(json_arena_t *arena) { JSON_INTERNAL_INCREF(arena); }
+
+void jsonp_arena_decref(json_arena_t *arena) {
+    arena_block_t *block, *next;
+
+    if (JSON_INTERNAL_DECREF(arena) != 0)
+        return;
+
+    for (block = arena->blocks; block; block = next) {
+        next = block->next;
+        jsonp_free(block);
+    }
+    jsonp_free(arena);
+}
+
+json_arena_t *jsonp_arena_install(json_arena_t *arena) {
+    json_arena_t *previous = current_arena;
+    current_arena = arena;
+    return previous;
+}
+
+json_arena_t *jsonp_arena_current(void) { return current_arena; }
+
+static void *arena_alloc(json_arena_t *arena, size_t size) {
+    arena_block_t *block = arena->blocks;
+    size_t block_size;
+    void *ptr;
+
+    size = ARENA_ALIGN_UP(size);
+    if (block && block->size - block->used >= size) {
+        ptr = arena_block_data(block) + block->used;
+        block->used += size;
+        return ptr;
+    }
+
+    if (size > arena->next_size / 2) {
+        /* Large values get a block of their own, behind the one being filled */
+        block = jsonp_malloc(ARENA_HEADER + size);
+        if (!block)
+            return NULL;
+
+        block->size = block->used = size;
+        if (arena->blocks) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = NULL;
+            arena->blocks = block;
+        }
+        return arena_block_data(block);
+    }
+
+    block_size = arena->next_size;
+    block = jsonp_malloc(ARENA_HEADER + block_size);
+    if (!block)
+        return NULL;
+
+    if (arena->next_size < ARENA_MAX_BLOCK)
+        arena->next_size *= 2;
+
+    block->size = block_size;
+    block->used = size;
+    block->next = arena->blocks;
+    arena->blocks = block;
+    return arena_block_data(block);
+}
+
+static int arena_owns(const json_arena_t *arena, const void *ptr) {
+    const arena_block_t *block;
+    const char *p = (const char *)ptr;
+
+    for (block = arena->blocks; block; block = block->next) {
+        if (p >= arena_block_data(block) && p < arena_block_data(block) + block->size)
+            return 1;
+    }
+    return 0;
+}
+
+void *jsonp_node_malloc(json_arena_t *arena, size_t size) {
+    if (!size)
+        return NULL;
+
+    if (!arena)
+        return jsonp_malloc(size);
+
+    if (arena == current_arena)
+        return arena_alloc(arena, size);
+
+    /* The document is being modified after it was loaded */
+    arena->heap_mixed = 1;
+    return jsonp_malloc(size);
+}
+
+void jsonp_node_free(json_arena_t *arena, void *ptr) {
+    if (!ptr)
+        return;
+
+    /* Arena memory is only released with the arena itself */
+    if (arena && (!arena->heap_mixed || arena_owns(arena, ptr)))
+        return;
+
+    jsonp_free(ptr);
+}
+
+char *jsonp_node_strndup(json_arena_t *arena, const char *str, size_t len) {
+    char *new_str;
+
+    new_str = jsonp_node_malloc(arena, len + 1);
+    if (!new_str)
+        return NULL;
+
+    memcpy(new_str, str, len);
+    new_str[len] = '\0';
+    return new_str;
+}
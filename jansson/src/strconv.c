@@ -2,6 +2,7 @@
 #include "strbuffer.h"
 #include <assert.h>
 #include <errno.h>
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
@@ -11,6 +12,17 @@
 #include <jansson_private_config.h>
 #endif
 
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
+#include "strconv_powers.h"
+
 #if JSON_HAVE_LOCALECONV
 #include <locale.h>
 
@@ -55,10 +67,237 @@ static void from_locale(char *buffer) {
 }
 #endif
 
+/*** number parsing ***/
+
+/* Largest integer that a double represents exactly, and the largest
+   power of ten with the same property */
+#define MAX_EXACT_INTEGER ((uint64_t)1 << 53)
+#define MAX_EXACT_POW10   22
+
+/* 64x64 -> 128 bit multiplication */
+static JSON_INLINE uint64_t umul128(uint64_t a, uint64_t b, uint64_t *high) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    *high = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, high);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl, lo;
+
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    *high = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo;
+#endif
+}
+
+static JSON_INLINE int leading_zeros64(uint64_t x) {
+    int n = 0;
+
+    if (!(x >> 32)) {
+        n += 32;
+        x <<= 32;
+    }
+    if (!(x >> 48)) {
+        n += 16;
+        x <<= 16;
+    }
+    if (!(x >> 56)) {
+        n += 8;
+        x <<= 8;
+    }
+    if (!(x >> 60)) {
+        n += 4;
+        x <<= 4;
+    }
+    if (!(x >> 62)) {
+        n += 2;
+        x <<= 2;
+    }
+    if (!(x >> 63))
+        n += 1;
+
+    return n;
+}
+
+static JSON_INLINE double double_from_bits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static JSON_INLINE uint64_t double_to_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/*
+  Eisel-Lemire: compute mantissa * 10^exp10 correctly rounded from a
+  128-bit approximation of the power of ten. Returns 0 if the result
+  can't be decided this way (a near halfway case, subnormals or
+  overflow); the caller then falls back to strtod().
+*/
+static int eisel_lemire(uint64_t mantissa, int exp10, int negative, double *out) {
+    const uint64_t *power;
+    uint64_t x_hi, x_lo, y_hi, y_lo, merged_hi, merged_lo, bits, msb;
+    uint64_t ret_mantissa, ret_exp2;
+    int clz;
+
+    if (exp10 < POWERS_OF_TEN_MIN_EXP10 || exp10 > POWERS_OF_TEN_MAX_EXP10)
+        return 0;
+
+    power = powers_of_ten[exp10 - POWERS_OF_TEN_MIN_EXP10];
+
+    /* normalization */
+    clz = leading_zeros64(mantissa);
+    mantissa <<= clz;
+    ret_exp2 = (uint64_t)(((217706 * exp10) >> 16) + 64 + 1023) - (uint64_t)clz;
+
+    /* multiplication, widened when the low bits are inconclusive */
+    x_lo = umul128(mantissa, power[0], &x_hi);
+    if ((x_hi & 0x1FF) == 0x1FF && x_lo + mantissa < mantissa) {
+        y_lo = umul128(mantissa, power[1], &y_hi);
+        merged_hi = x_hi;
+        merged_lo = x_lo + y_hi;
+        if (merged_lo < x_lo)
+            merged_hi++;
+
+        if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + mantissa < mantissa)
+            return 0;
+
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+
+    /* shift to 54 bits */
+    msb = x_hi >> 63;
+    ret_mantissa = x_hi >> (msb + 9);
+    ret_exp2 -= 1 ^ msb;
+
+    /* halfway ambiguity */
+    if (x_lo == 0 && (x_hi & 0x1FF) == 0 && (ret_mantissa & 3) == 1)
+        return 0;
+
+    /* round from 54 to 53 bits */
+    ret_mantissa += ret_mantissa & 1;
+    ret_mantissa >>= 1;
+    if (ret_mantissa >> 53) {
+        ret_mantissa >>= 1;
+        ret_exp2++;
+    }
+
+    /* subnormal, infinite or NaN */
+    if (ret_exp2 - 1 >= 0x7FF - 1)
+        return 0;
+
+    bits = ret_exp2 << 52 | (ret_mantissa & 0x000FFFFFFFFFFFFFULL);
+    if (negative)
+        bits |= 0x8000000000000000ULL;
+
+    *out = double_from_bits(bits);
+    return 1;
+}
+
+/*
+  Parse a number that the lexer has already validated. Returns 0 if it
+  had to give up (more than 19 significant digits or an undecidable
+  case) and strtod() has to be used.
+*/
+static int parse_number(const char *str, double *out) {
+    static const double exact_pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                         1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                         1e18, 1e19, 1e20, 1e21, 1e22};
+    uint64_t mantissa = 0;
+    int negative = 0, digits = 0, exp10 = 0, exp_negative = 0, exp_value = 0;
+    double value;
+
+    if (*str == '-') {
+        negative = 1;
+        str++;
+    }
+
+    /* leading zeros are not significant */
+    while (*str == '0')
+        str++;
+
+    for (; *str >= '0' && *str <= '9'; str++) {
+        if (mantissa == 0 && *str == '0')
+            continue;
+        if (++digits > 19)
+            return 0;
+        mantissa = mantissa * 10 + (uint64_t)(*str - '0');
+    }
+
+    if (*str == '.') {
+        for (str++; *str >= '0' && *str <= '9'; str++) {
+            exp10--;
+            if (mantissa == 0 && *str == '0')
+                continue;
+            if (++digits > 19)
+                return 0;
+            mantissa = mantissa * 10 + (uint64_t)(*str - '0');
+        }
+    }
+
+    if (*str == 'e' || *str == 'E') {
+        str++;
+        if (*str == '-') {
+            exp_negative = 1;
+            str++;
+        } else if (*str == '+') {
+            str++;
+        }
+
+        for (; *str >= '0' && *str <= '9'; str++) {
+            /* anything this large is out of range anyway */
+            if (exp_value < 100000)
+                exp_value = exp_value * 10 + (*str - '0');
+        }
+        exp10 += exp_negative ? -exp_value : exp_value;
+    }
+
+    if (mantissa == 0) {
+        *out = negative ? -0.0 : 0.0;
+        return 1;
+    }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    /* Clinger's fast path: both operands are exact, so the single
+       rounding of the multiplication or division is correct */
+    if (mantissa <= MAX_EXACT_INTEGER && exp10 >= -MAX_EXACT_POW10 &&
+        exp10 <= MAX_EXACT_POW10) {
+        value = (double)mantissa;
+        if (exp10 < 0)
+            value /= exact_pow10[-exp10];
+        else
+            value *= exact_pow10[exp10];
+
+        *out = negative ? -value : value;
+        return 1;
+    }
+#else
+    (void)exact_pow10;
+#endif
+
+    if (!eisel_lemire(mantissa, exp10, negative, &value))
+        return 0;
+
+    *out = value;
+    return 1;
+}
+
 int jsonp_strtod(strbuffer_t *strbuffer, double *out) {
     double value;
     char *end;
 
+    if (parse_number(strbuffer->value, out))
+        return 0;
+
 #if JSON_HAVE_LOCALECONV
     to_locale(strbuffer);
 #endif
@@ -76,11 +315,256 @@ int jsonp_strtod(strbuffer_t *strbuffer, double *out) {
     return 0;
 }
 
+int json_strtod(const char *str, size_t len, double *out) {
+    char buffer[64];
+    strbuffer_t strbuffer;
+    int result;
+
+    /* parse_number() and strtod() need the text to end after the number */
+    if (len < sizeof(buffer)) {
+        memcpy(buffer, str, len);
+        buffer[len] = '\0';
+        if (parse_number(buffer, out))
+            return 0;
+    }
+
+    if (strbuffer_init(&strbuffer) || strbuffer_append_bytes(&strbuffer, str, len)) {
+        strbuffer_close(&strbuffer);
+        *out = 0.0;
+        return -1;
+    }
+
+    result = jsonp_strtod(&strbuffer, out);
+    if (result)
+        *out = (*str == '-') ? -HUGE_VAL : HUGE_VAL;
+    strbuffer_close(&strbuffer);
+    return result;
+}
+
+/*** number formatting ***/
+
+/*
+  Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+  Accurately with Integers") generates the shortest digit string that
+  reads back as the same double in the vast majority of cases, and a
+  string that round trips in all cases, using only 64-bit integers.
+*/
+
+typedef struct {
+    uint64_t f;
+    int e;
+} diyfp_t;
+
+#define DIYFP_ALPHA -60
+#define DIYFP_GAMMA -32
+
+static JSON_INLINE diyfp_t diyfp_make(uint64_t f, int e) {
+    diyfp_t result;
+    result.f = f;
+    result.e = e;
+    return result;
+}
+
+/* x * y rounded to 64 bits */
+static JSON_INLINE diyfp_t diyfp_mul(diyfp_t x, diyfp_t y) {
+    uint64_t high, low = umul128(x.f, y.f, &high);
+    return diyfp_make(high + (low >> 63), x.e + y.e + 64);
+}
+
+static JSON_INLINE diyfp_t diyfp_normalize(diyfp_t x) {
+    int shift = leading_zeros64(x.f);
+    return diyfp_make(x.f << shift, x.e - shift);
+}
+
+/* Boundaries m- and m+ of the rounding interval of v, with v and m+
+   normalized and m- sharing the exponent of m+ */
+static void compute_boundaries(double value, diyfp_t *w, diyfp_t *w_minus,
+                               diyfp_t *w_plus) {
+    const uint64_t hidden_bit = (uint64_t)1 << 52;
+    uint64_t bits = double_to_bits(value);
+    uint64_t biased_e = (bits >> 52) & 0x7FF, fraction = bits & (hidden_bit - 1);
+    diyfp_t v, m_minus, m_plus;
+
+    if (biased_e == 0)
+        v = diyfp_make(fraction, 1 - 1075);
+    else
+        v = diyfp_make(fraction + hidden_bit, (int)biased_e - 1075);
+
+    /* the lower boundary is closer if v is a power of two */
+    m_plus = diyfp_make(2 * v.f + 1, v.e - 1);
+    if (fraction == 0 && biased_e > 1)
+        m_minus = diyfp_make(4 * v.f - 1, v.e - 2);
+    else
+        m_minus = diyfp_make(2 * v.f - 1, v.e - 1);
+
+    *w_plus = diyfp_normalize(m_plus);
+    *w_minus = diyfp_make(m_minus.f << (m_minus.e - w_plus->e), w_plus->e);
+    *w = diyfp_normalize(v);
+}
+
+/* Move the last digit towards w while staying inside the interval */
+static void grisu2_round(char *buffer, int length, uint64_t dist, uint64_t delta,
+                         uint64_t rest, uint64_t ten_k) {
+    while (rest < dist && delta - rest >= ten_k &&
+           (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+        buffer[length - 1]--;
+        rest += ten_k;
+    }
+}
+
+static int grisu2_digit_gen(char *buffer, int *decimal_exponent, diyfp_t m_minus,
+                            diyfp_t w, diyfp_t m_plus) {
+    static const uint32_t pow10[] = {1,      10,      100,      1000,      10000,
+                                     100000, 1000000, 10000000, 100000000, 1000000000};
+    uint64_t delta = m_plus.f - m_minus.f, dist = m_plus.f - w.f, rest;
+    int shift = -m_plus.e, length = 0, n, m = 0;
+    uint64_t one = (uint64_t)1 << shift;
+    uint32_t p1 = (uint32_t)(m_plus.f >> shift), digit;
+    uint64_t p2 = m_plus.f & (one - 1);
+
+    /* integral part, p1 < 10^10 because of the choice of alpha/gamma */
+    for (n = 10; n > 1 && p1 < pow10[n - 1]; n--)
+        ;
+
+    while (n > 0) {
+        digit = p1 / pow10[n - 1];
+        p1 %= pow10[n - 1];
+        buffer[length++] = (char)('0' + digit);
+        n--;
+
+        rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            *decimal_exponent += n;
+            grisu2_round(buffer, length, dist, delta, rest, (uint64_t)pow10[n] << shift);
+            return length;
+        }
+    }
+
+    /* fractional part */
+    while (1) {
+        p2 *= 10;
+        buffer[length++] = (char)('0' + (p2 >> shift));
+        p2 &= one - 1;
+        m++;
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta)
+            break;
+    }
+
+    *decimal_exponent -= m;
+    grisu2_round(buffer, length, dist, delta, p2, one);
+    return length;
+}
+
+/* Digits of a positive finite value, value = digits * 10^decimal_exponent */
+static int grisu2(char *buffer, int *decimal_exponent, double value) {
+    diyfp_t w, w_minus, w_plus, c_minus_k;
+    int f, k, index;
+
+    compute_boundaries(value, &w, &w_minus, &w_plus);
+
+    /* cached power c = 10^-k with alpha <= e_c + w_plus.e + 64 <= gamma */
+    f = DIYFP_ALPHA - w_plus.e - 1;
+    k = (f * 78913) / (1 << 18) + (f > 0);
+    index = (-CACHED_POWERS_MIN_DEC_EXP + k + (CACHED_POWERS_DEC_STEP - 1)) /
+            CACHED_POWERS_DEC_STEP;
+    c_minus_k = diyfp_make(cached_powers[index].f, cached_powers[index].e);
+
+    w = diyfp_mul(w, c_minus_k);
+    w_minus = diyfp_mul(w_minus, c_minus_k);
+    w_plus = diyfp_mul(w_plus, c_minus_k);
+
+    /* shrink the interval by one unit on each side to account for the
+       rounding error of the multiplications */
+    w_minus.f++;
+    w_plus.f--;
+
+    *decimal_exponent = -cached_powers[index].k;
+    return grisu2_digit_gen(buffer, decimal_exponent, w_minus, w, w_plus);
+}
+
+/*
+  Lay out the digits like "%.17g" followed by the fixups below would:
+  plain notation for decimal exponents -4 to 16 with ".0" added to
+  integers, otherwise d.ddde[-]x without a plus sign or leading zeros.
+*/
+static int format_shortest(char *buffer, double value) {
+    char digits[32], *out = buffer;
+    int length, decimal_exponent, exponent, i;
+
+    if (double_to_bits(value) >> 63) {
+        *out++ = '-';
+        value = -value;
+    }
+
+    if (value == 0.0) {
+        memcpy(out, "0.0", 4);
+        return (int)(out - buffer) + 3;
+    }
+
+    length = grisu2(digits, &decimal_exponent, value);
+    exponent = length + decimal_exponent - 1;
+
+    if (exponent < -4 || exponent >= 17) {
+        *out++ = digits[0];
+        if (length > 1) {
+            *out++ = '.';
+            memcpy(out, digits + 1, (size_t)length - 1);
+            out += length - 1;
+        }
+        *out++ = 'e';
+        if (exponent < 0) {
+            *out++ = '-';
+            exponent = -exponent;
+        }
+        if (exponent >= 100)
+            *out++ = (char)('0' + exponent / 100);
+        if (exponent >= 10)
+            *out++ = (char)('0' + exponent / 10 % 10);
+        *out++ = (char)('0' + exponent % 10);
+    } else if (exponent < 0) {
+        *out++ = '0';
+        *out++ = '.';
+        for (i = -1; i > exponent; i--)
+            *out++ = '0';
+        memcpy(out, digits, (size_t)length);
+        out += length;
+    } else if (exponent + 1 >= length) {
+        memcpy(out, digits, (size_t)length);
+        out += length;
+        for (i = length; i <= exponent; i++)
+            *out++ = '0';
+        *out++ = '.';
+        *out++ = '0';
+    } else {
+        memcpy(out, digits, (size_t)exponent + 1);
+        out += exponent + 1;
+        *out++ = '.';
+        memcpy(out, digits + exponent + 1, (size_t)(length - exponent - 1));
+        out += length - exponent - 1;
+    }
+
+    *out = '\0';
+    return (int)(out - buffer);
+}
+
 int jsonp_dtostr(char *buffer, size_t size, double value, int precision) {
     int ret;
     char *start, *end;
     size_t length;
 
+    if (precision == 0 && isfinite(value)) {
+        char shortest[32];
+
+        ret = format_shortest(shortest, value);
+        if ((size_t)ret >= size)
+            return -1;
+
+        memcpy(buffer, shortest, (size_t)ret + 1);
+        return ret;
+    }
+
     if (precision == 0)
         precision = 17;
 
@@ -39,9 +39,12 @@ static JSON_INLINE int isinf(double x) { return !isnan(x) && isnan(x - x); }
 
 json_t *do_deep_copy(const json_t *json, hashtable_t *parents);
 
-static JSON_INLINE void json_init(json_t *json, json_type type) {
+static JSON_INLINE void json_init(json_t *json, json_type type, json_arena_t *arena) {
     json->type = type;
     json->refcount = 1;
+    json->arena = arena;
+    if (arena)
+        jsonp_arena_incref(arena);
 }
 
 int jsonp_loop_check(hashtable_t *parents, const json_t *json, char *key, size_t key_size,
@@ -62,7 +65,8 @@ int jsonp_loop_check(hashtable_t *parents, const json_t *json, char *key, size_t
 extern volatile uint32_t hashtable_seed;
 
 json_t *json_object(void) {
-    json_object_t *object = jsonp_malloc(sizeof(json_object_t));
+    json_arena_t *arena = jsonp_arena_current();
+    json_object_t *object = jsonp_node_malloc(arena, sizeof(json_object_t));
     if (!object)
         return NULL;
 
@@ -71,19 +75,19 @@ json_t *json_object(void) {
         json_object_seed(0);
     }
 
-    json_init(&object->json, JSON_OBJECT);
-
-    if (hashtable_init(&object->hashtable)) {
-        jsonp_free(object);
+    if (hashtable_init_arena(&object->hashtable, arena)) {
+        jsonp_node_free(arena, object);
         return NULL;
     }
 
+    json_init(&object->json, JSON_OBJECT, arena);
+
     return &object->json;
 }
 
 static void json_delete_object(json_object_t *object) {
     hashtable_close(&object->hashtable);
-    jsonp_free(object);
+    jsonp_node_free(object->json.arena, object);
 }
 
 size_t json_object_size(const json_t *json) {
@@ -142,6 +146,36 @@ int json_object_setn_new_nocheck(json_t *json, const char *key, size_t key_len,
     return 0;
 }
 
+int json_object_set_key_new(json_t *json, json_key_t *key, json_t *value) {
+    json_object_t *object;
+
+    if (!value)
+        return -1;
+
+    if (!key || !json_is_object(json) || json == value) {
+        json_decref(value);
+        return -1;
+    }
+    object = json_to_object(json);
+
+    if (hashtable_set_key(&object->hashtable, key, value)) {
+        json_decref(value);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Stores value under the key an iterator of another object points at */
+static int json_object_set_iter_key_new(json_t *json, void *iter, json_t *value) {
+    json_key_t *interned = hashtable_iter_interned_key(iter);
+    if (interned)
+        return json_object_set_key_new(json, interned, value);
+
+    return json_object_setn_new_nocheck(json, hashtable_iter_key(iter),
+                                        hashtable_iter_key_len(iter), value);
+}
+
 int json_object_set_new(json_t *json, const char *key, json_t *value) {
     if (!key) {
         json_decref(value);
@@ -349,9 +383,56 @@ void *json_object_key_to_iter(const char *key) {
     if (!key)
         return NULL;
 
+    /* an interned key is not inside a pair, and without the object
+       its pair can't be found */
+    if (container_of(key, json_key_t, str)->refcount != JSON_KEY_INLINE)
+        return NULL;
+
     return hashtable_key_to_iter(key);
 }
 
+void *json_object_iter_for_key(json_t *json, const char *key) {
+    json_key_t *record;
+
+    if (!key)
+        return NULL;
+
+    record = container_of(key, json_key_t, str);
+    if (record->refcount == JSON_KEY_INLINE)
+        return hashtable_key_to_iter(key);
+
+    if (!json_is_object(json))
+        return NULL;
+
+    return hashtable_iter_at_key(&json_to_object(json)->hashtable, record);
+}
+
+/*** interned keys ***/
+
+json_key_t *json_key(const char *key) {
+    if (!key)
+        return NULL;
+
+    return json_keyn(key, strlen(key));
+}
+
+json_key_t *json_keyn(const char *key, size_t key_len) {
+    if (!key || !utf8_check_string(key, key_len) || memchr(key, '\0', key_len))
+        return NULL;
+
+    if (!hashtable_seed) {
+        /* Autoseed, the hash is computed here */
+        json_object_seed(0);
+    }
+
+    return jsonp_key_create(key, key_len);
+}
+
+void json_key_decref(json_key_t *key) {
+    if (key)
+        jsonp_key_decref(key);
+}
+
 static int json_object_equal(const json_t *object1, const json_t *object2) {
     const char *key;
     size_t key_len;
@@ -372,17 +453,14 @@ static int json_object_equal(const json_t *object1, const json_t *object2) {
 
 static json_t *json_object_copy(json_t *object) {
     json_t *result;
-
-    const char *key;
-    size_t key_len;
-    json_t *value;
+    void *iter;
 
     result = json_object();
     if (!result)
         return NULL;
 
-    json_object_keylen_foreach(object, key, key_len, value)
-        json_object_setn_nocheck(result, key, key_len, value);
+    for (iter = json_object_iter(object); iter; iter = json_object_iter_next(object, iter))
+        json_object_set_iter_key_new(result, iter, json_incref(json_object_iter_value(iter)));
 
     return result;
 }
@@ -401,17 +479,15 @@ static json_t *json_object_deep_copy(const json_t *object, hashtable_t *parents)
         goto out;
 
     /* Cannot use json_object_foreach because object has to be cast
-       non-const */
+       non-const. Interned keys are duplicated rather than shared, so the
+       copy holds no reference counts in common with the original and can
+       be released on another thread. */
     iter = json_object_iter((json_t *)object);
     while (iter) {
-        const char *key;
-        size_t key_len;
-        const json_t *value;
-        key = json_object_iter_key(iter);
-        key_len = json_object_iter_key_len(iter);
-        value = json_object_iter_value(iter);
-
-        if (json_object_setn_new_nocheck(result, key, key_len,
+        const json_t *value = json_object_iter_value(iter);
+
+        if (json_object_setn_new_nocheck(result, json_object_iter_key(iter),
+                                         json_object_iter_key_len(iter),
                                          do_deep_copy(value, parents))) {
             json_decref(result);
             result = NULL;
@@ -429,20 +505,22 @@ out:
 /*** array ***/
 
 json_t *json_array(void) {
-    json_array_t *array = jsonp_malloc(sizeof(json_array_t));
+    json_arena_t *arena = jsonp_arena_current();
+    json_array_t *array = jsonp_node_malloc(arena, sizeof(json_array_t));
     if (!array)
         return NULL;
-    json_init(&array->json, JSON_ARRAY);
 
     array->entries = 0;
     array->size = 8;
 
-    array->table = jsonp_malloc(array->size * sizeof(json_t *));
+    array->table = jsonp_node_malloc(arena, array->size * sizeof(json_t *));
     if (!array->table) {
-        jsonp_free(array);
+        jsonp_node_free(arena, array);
         return NULL;
     }
 
+    json_init(&array->json, JSON_ARRAY, arena);
+
     return &array->json;
 }
 
@@ -452,8 +530,8 @@ static void json_delete_array(json_array_t *array) {
     for (i = 0; i < array->entries; i++)
         json_decref(array->table[i]);
 
-    jsonp_free(array->table);
-    jsonp_free(array);
+    jsonp_node_free(array->json.arena, array->table);
+    jsonp_node_free(array->json.arena, array);
 }
 
 size_t json_array_size(const json_t *json) {
@@ -517,7 +595,7 @@ static json_t **json_array_grow(json_array_t *array, size_t amount, int copy) {
     old_table = array->table;
 
     new_size = max(array->size + amount, array->size * 2);
-    new_table = jsonp_malloc(new_size * sizeof(json_t *));
+    new_table = jsonp_node_malloc(array->json.arena, new_size * sizeof(json_t *));
     if (!new_table)
         return NULL;
 
@@ -526,7 +604,7 @@ static json_t **json_array_grow(json_array_t *array, size_t amount, int copy) {
 
     if (copy) {
         array_copy(array->table, 0, old_table, 0, array->entries);
-        jsonp_free(old_table);
+        jsonp_node_free(array->json.arena, old_table);
         return array->table;
     }
 
@@ -583,7 +661,7 @@ int json_array_insert_new(json_t *json, size_t index, json_t *value) {
     if (old_table != array->table) {
         array_copy(array->table, 0, old_table, 0, index);
         array_copy(array->table, index + 1, old_table, index, array->entries - index);
-        jsonp_free(old_table);
+        jsonp_node_free(array->json.arena, old_table);
     } else
         array_move(array, index + 1, index, array->entries - index);
 
@@ -715,26 +793,30 @@ out:
 /*** string ***/
 
 static json_t *string_create(const char *value, size_t len, int own) {
+    json_arena_t *arena = jsonp_arena_current();
     char *v;
     json_string_t *string;
 
     if (!value)
         return NULL;
 
-    if (own)
+    if (own && !arena)
         v = (char *)value;
     else {
-        v = jsonp_strndup(value, len);
+        /* An owned heap buffer is moved into the arena */
+        v = jsonp_node_strndup(arena, value, len);
+        if (own)
+            jsonp_free((char *)value);
         if (!v)
             return NULL;
     }
 
-    string = jsonp_malloc(sizeof(json_string_t));
+    string = jsonp_node_malloc(arena, sizeof(json_string_t));
     if (!string) {
-        jsonp_free(v);
+        jsonp_node_free(arena, v);
         return NULL;
     }
-    json_init(&string->json, JSON_STRING);
+    json_init(&string->json, JSON_STRING, arena);
     string->value = v;
     string->length = len;
 
@@ -799,12 +881,12 @@ int json_string_setn_nocheck(json_t *json, const char *value, size_t len) {
     if (!json_is_string(json) || !value)
         return -1;
 
-    dup = jsonp_strndup(value, len);
+    string = json_to_string(json);
+    dup = jsonp_node_strndup(json->arena, value, len);
     if (!dup)
         return -1;
 
-    string = json_to_string(json);
-    jsonp_free(string->value);
+    jsonp_node_free(json->arena, string->value);
     string->value = dup;
     string->length = len;
 
@@ -826,8 +908,8 @@ int json_string_setn(json_t *json, const char *value, size_t len) {
 }
 
 static void json_delete_string(json_string_t *string) {
-    jsonp_free(string->value);
-    jsonp_free(string);
+    jsonp_node_free(string->json.arena, string->value);
+    jsonp_node_free(string->json.arena, string);
 }
 
 static int json_string_equal(const json_t *string1, const json_t *string2) {
@@ -891,10 +973,11 @@ json_t *json_sprintf(const char *fmt, ...) {
 /*** integer ***/
 
 json_t *json_integer(json_int_t value) {
-    json_integer_t *integer = jsonp_malloc(sizeof(json_integer_t));
+    json_arena_t *arena = jsonp_arena_current();
+    json_integer_t *integer = jsonp_node_malloc(arena, sizeof(json_integer_t));
     if (!integer)
         return NULL;
-    json_init(&integer->json, JSON_INTEGER);
+    json_init(&integer->json, JSON_INTEGER, arena);
 
     integer->value = value;
     return &integer->json;
@@ -916,7 +999,9 @@ int json_integer_set(json_t *json, json_int_t value) {
     return 0;
 }
 
-static void json_delete_integer(json_integer_t *integer) { jsonp_free(integer); }
+static void json_delete_integer(json_integer_t *integer) {
+    jsonp_node_free(integer->json.arena, integer);
+}
 
 static int json_integer_equal(const json_t *integer1, const json_t *integer2) {
     return json_integer_value(integer1) == json_integer_value(integer2);
@@ -929,15 +1014,16 @@ static json_t *json_integer_copy(const json_t *integer) {
 /*** real ***/
 
 json_t *json_real(double value) {
+    json_arena_t *arena = jsonp_arena_current();
     json_real_t *real;
 
     if (isnan(value) || isinf(value))
         return NULL;
 
-    real = jsonp_malloc(sizeof(json_real_t));
+    real = jsonp_node_malloc(arena, sizeof(json_real_t));
     if (!real)
         return NULL;
-    json_init(&real->json, JSON_REAL);
+    json_init(&real->json, JSON_REAL, arena);
 
     real->value = value;
     return &real->json;
@@ -959,7 +1045,7 @@ int json_real_set(json_t *json, double value) {
     return 0;
 }
 
-static void json_delete_real(json_real_t *real) { jsonp_free(real); }
+static void json_delete_real(json_real_t *real) { jsonp_node_free(real->json.arena, real); }
 
 static int json_real_equal(const json_t *real1, const json_t *real2) {
     return json_real_value(real1) == json_real_value(real2);
@@ -983,26 +1069,30 @@ double json_number_value(const json_t *json) {
 /*** simple values ***/
 
 json_t *json_true(void) {
-    static json_t the_true = {JSON_TRUE, (size_t)-1};
+    static json_t the_true = {JSON_TRUE, (size_t)-1, NULL};
     return &the_true;
 }
 
 json_t *json_false(void) {
-    static json_t the_false = {JSON_FALSE, (size_t)-1};
+    static json_t the_false = {JSON_FALSE, (size_t)-1, NULL};
     return &the_false;
 }
 
 json_t *json_null(void) {
-    static json_t the_null = {JSON_NULL, (size_t)-1};
+    static json_t the_null = {JSON_NULL, (size_t)-1, NULL};
     return &the_null;
 }
 
 /*** deletion ***/
 
 void json_delete(json_t *json) {
+    json_arena_t *arena;
+
     if (!json)
         return;
 
+    arena = json->arena;
+
     switch (json_typeof(json)) {
         case JSON_OBJECT:
             json_delete_object(json_to_object(json));
@@ -1024,6 +1114,9 @@ void json_delete(json_t *json) {
     }
 
     /* json_delete is not called for true, false or null */
+
+    if (arena)
+        jsonp_arena_decref(arena);
 }
 
 /*** equality ***/
@@ -0,0 +1,128 @@
+/*
+ * String hash used by the object hashtable, after wyhash (final version 4)
+ * by Wang Yi, released into the public domain. Keys are read 4 or 8 bytes
+ * at a time and mixed with 64x64->128 bit multiplications, which makes
+ * short keys take only a few instructions.
+ *
+ * Hash values depend on the byte order of the host and are never stored.
+ */
+
+#ifndef WYHASH_H
+#define WYHASH_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include <jansson_private_config.h>
+#endif
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
+#include <jansson_config.h> /* for JSON_INLINE */
+
+static const uint64_t wyhash_p0 = 0xa0761d6478bd642fULL;
+static const uint64_t wyhash_p1 = 0xe7037ed1a0b428dbULL;
+static const uint64_t wyhash_p2 = 0x8ebc6af09c88c6e3ULL;
+static const uint64_t wyhash_p3 = 0x589965cc75374cc3ULL;
+
+/* Multiply A and B to 128 bits, storing the low half in A and the high in B */
+static JSON_INLINE void wyhash_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *a = _umul128(*a, *b, b);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl, lo;
+
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static JSON_INLINE uint64_t wyhash_mix(uint64_t a, uint64_t b) {
+    wyhash_mum(&a, &b);
+    return a ^ b;
+}
+
+static JSON_INLINE uint64_t wyhash_read8(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static JSON_INLINE uint64_t wyhash_read4(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/* 1 to 3 bytes */
+static JSON_INLINE uint64_t wyhash_read3(const uint8_t *p, size_t len) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+}
+
+static JSON_INLINE uint64_t wyhash(const void *key, size_t len, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t a, b;
+
+    seed ^= wyhash_mix(seed ^ wyhash_p0, wyhash_p1);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t offset = (len >> 3) << 2;
+            a = (wyhash_read4(p) << 32) | wyhash_read4(p + offset);
+            b = (wyhash_read4(p + len - 4) << 32) | wyhash_read4(p + len - 4 - offset);
+        } else if (len > 0) {
+            a = wyhash_read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wyhash_mix(wyhash_read8(p) ^ wyhash_p1, wyhash_read8(p + 8) ^ seed);
+                see1 = wyhash_mix(wyhash_read8(p + 16) ^ wyhash_p2,
+                                  wyhash_read8(p + 24) ^ see1);
+                see2 = wyhash_mix(wyhash_read8(p + 32) ^ wyhash_p3,
+                                  wyhash_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16) {
+            seed = wyhash_mix(wyhash_read8(p) ^ wyhash_p1, wyhash_read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = wyhash_read8(p + i - 16);
+        b = wyhash_read8(p + i - 8);
+    }
+
+    a ^= wyhash_p1;
+    b ^= seed;
+    wyhash_mum(&a, &b);
+    return wyhash_mix(a ^ wyhash_p0 ^ len, b ^ wyhash_p1);
+}
+
+#endif
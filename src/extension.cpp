@@ -21,10 +21,15 @@
 
 #include "extension.h"
 #include "httprequest.h"
+#include "json_lines.h"
+#include "json_view.h"
+#include "jsonfilecontext.h"
 #include "queue.h"
 #include "websocket_connection_base.h"
 #include "websocket_eventloop.h"
+#include "websocket_server.h"
 #include <atomic>
+#include <unordered_set>
 
 // Limit the max processing request per tick
 #define MAX_PROCESS 10
@@ -35,6 +40,10 @@ SMEXT_LINK(&g_RipExt);
 
 LockedQueue<IHTTPContext *> g_RequestQueue;
 LockedQueue<IHTTPContext *> g_CompletedRequestQueue;
+LockedQueue<std::shared_ptr<JSONRecordQueue>> g_ResumeQueue;
+
+LockedQueue<JSONFileContext *> g_FileQueue;
+LockedQueue<JSONFileContext *> g_CompletedFileQueue;
 
 CURLM *g_Curl;
 uv_loop_t *g_Loop;
@@ -42,8 +51,13 @@ uv_thread_t g_Thread;
 uv_timer_t g_Timeout;
 
 uv_async_t g_AsyncPerformRequests;
+uv_async_t g_AsyncPerformFiles;
 uv_async_t g_AsyncStopLoop;
 
+// File jobs handed to the libuv thread pool, only touched on the event loop thread
+std::unordered_set<JSONFileContext *> g_PerformingFiles;
+bool g_StoppingLoop;
+
 HTTPRequestHandler g_HTTPRequestHandler;
 HandleType_t htHTTPRequest;
 
@@ -56,9 +70,17 @@ HandleType_t htJSON;
 JSONObjectKeysHandler g_JSONObjectKeysHandler;
 HandleType_t htJSONObjectKeys;
 
+JSONViewHandler g_JSONViewHandler;
+HandleType_t htJSONView;
+
 WebSocketHandler g_WebSocketHandler;
 HandleType_t htWebSocket;
 
+WebSocketServerHandler g_WebSocketServerHandler;
+HandleType_t htWebSocketServer;
+
+HandleType_t htCellArray;
+
 std::atomic<bool> unloaded;
 
 static void CheckCompletedRequests()
@@ -195,16 +217,83 @@ static void AsyncPerformRequests(uv_async_t *handle)
 	}
 
 	g_RequestQueue.Unlock();
+
+	/* Transfers paused by a full record queue that the game thread has drained */
+	g_ResumeQueue.Lock();
+	while (!g_ResumeQueue.Empty())
+	{
+		g_ResumeQueue.Pop()->Resume();
+	}
+	g_ResumeQueue.Unlock();
 }
 
-static void AsyncStopLoop(uv_async_t *handle)
+static void PerformFile(uv_work_t *req)
 {
+	((JSONFileContext *)req->data)->Perform();
+}
+
+static void StopLoop()
+{
+	uv_close((uv_handle_t *)&g_AsyncPerformFiles, nullptr);
 	uv_stop(g_Loop);
 }
 
+static void CompleteFile(uv_work_t *req, int status)
+{
+	JSONFileContext *context = (JSONFileContext *)req->data;
+	g_PerformingFiles.erase(context);
+
+	g_CompletedFileQueue.Lock();
+	g_CompletedFileQueue.Push(context);
+	g_CompletedFileQueue.Unlock();
+
+	// The extension is unloading and was only waiting for this job
+	if (g_StoppingLoop && g_PerformingFiles.empty())
+	{
+		StopLoop();
+	}
+}
+
+static void AsyncPerformFiles(uv_async_t *handle)
+{
+	if (g_StoppingLoop)
+	{
+		return;
+	}
+
+	g_FileQueue.Lock();
+
+	// File I/O runs on the libuv thread pool, not on the event loop itself
+	while (!g_FileQueue.Empty())
+	{
+		JSONFileContext *context = g_FileQueue.Pop();
+		uv_queue_work(g_Loop, &context->work, &PerformFile, &CompleteFile);
+		g_PerformingFiles.insert(context);
+	}
+
+	g_FileQueue.Unlock();
+}
+
+static void AsyncStopLoop(uv_async_t *handle)
+{
+	g_StoppingLoop = true;
+
+	// Jobs that haven't started are cancelled, their CompleteFile still runs with UV_ECANCELED.
+	// Jobs already running on a worker have to finish before the extension can go away.
+	for (JSONFileContext *context : g_PerformingFiles)
+	{
+		uv_cancel((uv_req_t *)&context->work);
+	}
+
+	if (g_PerformingFiles.empty())
+	{
+		StopLoop();
+	}
+}
+
 static void FrameHook(bool simulating)
 {
-	if (!g_RequestQueue.Empty())
+	if (!g_RequestQueue.Empty() || !g_ResumeQueue.Empty())
 	{
 		uv_async_send(&g_AsyncPerformRequests);
 	}
@@ -219,6 +308,21 @@ static void FrameHook(bool simulating)
 
 		g_CompletedRequestQueue.Unlock();
 	}
+
+	if (!g_FileQueue.Empty())
+	{
+		uv_async_send(&g_AsyncPerformFiles);
+	}
+
+	if (!g_CompletedFileQueue.Empty())
+	{
+		g_CompletedFileQueue.Lock();
+		JSONFileContext *context = g_CompletedFileQueue.Pop();
+		g_CompletedFileQueue.Unlock();
+
+		context->OnCompleted();
+		delete context;
+	}
 }
 
 bool RipExt::SDK_OnLoad(char *error, size_t maxlength, bool late)
@@ -245,7 +349,9 @@ bool RipExt::SDK_OnLoad(char *error, size_t maxlength, bool late)
 	g_Loop = uv_default_loop();
 	uv_timer_init(g_Loop, &g_Timeout);
 	uv_async_init(g_Loop, &g_AsyncPerformRequests, &AsyncPerformRequests);
+	uv_async_init(g_Loop, &g_AsyncPerformFiles, &AsyncPerformFiles);
 	uv_async_init(g_Loop, &g_AsyncStopLoop, &AsyncStopLoop);
+	g_StoppingLoop = false;
 	uv_thread_create(&g_Thread, &EventLoop, nullptr);
 
 	/* Set up access rights for the 'HTTPRequest' handle type */
@@ -277,7 +383,15 @@ bool RipExt::SDK_OnLoad(char *error, size_t maxlength, bool late)
 	htHTTPResponse = handlesys->CreateType("HTTPResponse", &g_HTTPResponseHandler, 0, nullptr, &haHTTPResponse, myself->GetIdentity(), nullptr);
 	htJSON = handlesys->CreateType("JSON", &g_JSONHandler, 0, nullptr, &haJSON, myself->GetIdentity(), nullptr);
 	htJSONObjectKeys = handlesys->CreateType("JSONObjectKeys", &g_JSONObjectKeysHandler, 0, nullptr, nullptr, myself->GetIdentity(), nullptr);
+	htJSONView = handlesys->CreateType("JSONView", &g_JSONViewHandler, 0, nullptr, nullptr, myself->GetIdentity(), nullptr);
 	htWebSocket = handlesys->CreateType("WebSocket", &g_WebSocketHandler, 0, &taWS, &haWS, myself->GetIdentity(), nullptr);
+	htWebSocketServer = handlesys->CreateType("WebSocketServer", &g_WebSocketServerHandler, 0, &taWS, &haWS, myself->GetIdentity(), nullptr);
+
+	/* ArrayList handles are created by SourceMod, JSON only reads and fills them */
+	if (!handlesys->FindHandleType("CellArray", &htCellArray))
+	{
+		htCellArray = NO_HANDLE_TYPE;
+	}
 
 	smutils->AddGameFrameHook(&FrameHook);
 	smutils->BuildPath(Path_SM, caBundlePath, sizeof(caBundlePath), SM_RIPEXT_CA_BUNDLE_PATH);
@@ -295,6 +409,16 @@ void RipExt::SDK_OnUnload()
 	uv_thread_join(&g_Thread);
 	uv_loop_close(g_Loop);
 
+	/* No plugin callbacks during unload, just free the file jobs that never completed */
+	while (!g_FileQueue.Empty())
+	{
+		delete g_FileQueue.Pop();
+	}
+	while (!g_CompletedFileQueue.Empty())
+	{
+		delete g_CompletedFileQueue.Pop();
+	}
+
 	curl_multi_cleanup(&g_Curl);
 	curl_global_cleanup();
 
@@ -302,6 +426,8 @@ void RipExt::SDK_OnUnload()
 	handlesys->RemoveType(htHTTPResponse, myself->GetIdentity());
 	handlesys->RemoveType(htJSON, myself->GetIdentity());
 	handlesys->RemoveType(htJSONObjectKeys, myself->GetIdentity());
+	handlesys->RemoveType(htJSONView, myself->GetIdentity());
+	handlesys->RemoveType(htWebSocketServer, myself->GetIdentity());
 	handlesys->RemoveType(htWebSocket, myself->GetIdentity());
 
 	smutils->RemoveGameFrameHook(&FrameHook);
@@ -318,6 +444,20 @@ void RipExt::AddRequestToQueue(IHTTPContext *context)
 	g_RequestQueue.Unlock();
 }
 
+void RipExt::AddResumeToQueue(std::shared_ptr<JSONRecordQueue> records)
+{
+	g_ResumeQueue.Lock();
+	g_ResumeQueue.Push(records);
+	g_ResumeQueue.Unlock();
+}
+
+void RipExt::AddFileToQueue(JSONFileContext *context)
+{
+	g_FileQueue.Lock();
+	g_FileQueue.Push(context);
+	g_FileQueue.Unlock();
+}
+
 void log_msg(void *msg)
 {
 	if (!unloaded.load())
@@ -390,6 +530,18 @@ void JSONObjectKeysHandler::OnHandleDestroy(HandleType_t type, void *object)
 	delete (struct JSONObjectKeys *)object;
 }
 
+void JSONViewHandler::OnHandleDestroy(HandleType_t type, void *object)
+{
+	delete (struct JSONView *)object;
+}
+
+bool JSONViewHandler::GetHandleApproxSize(HandleType_t type, void *object, unsigned int *size)
+{
+	/* Views into the same document all report its size */
+	*size = static_cast<unsigned int>(((struct JSONView *)object)->document->GetMemoryUsage());
+	return true;
+}
+
 void WebSocketHandler::OnHandleDestroy(HandleType_t type, void *object)
 {
 	reinterpret_cast<websocket_connection_base *>(object)->destroy();
@@ -397,6 +549,17 @@ void WebSocketHandler::OnHandleDestroy(HandleType_t type, void *object)
 
 bool WebSocketHandler::GetHandleApproxSize(HandleType_t type, void *object, unsigned int *size)
 {
-	*size = sizeof(websocket_connection_base);
+	*size = static_cast<unsigned int>(reinterpret_cast<websocket_connection_base *>(object)->approx_size());
+	return true;
+}
+
+void WebSocketServerHandler::OnHandleDestroy(HandleType_t type, void *object)
+{
+	reinterpret_cast<websocket_server *>(object)->destroy();
+}
+
+bool WebSocketServerHandler::GetHandleApproxSize(HandleType_t type, void *object, unsigned int *size)
+{
+	*size = sizeof(websocket_server);
 	return true;
 }
@@ -39,6 +39,9 @@
 
 extern uv_loop_t *g_Loop;
 
+class JSONFileContext;
+class JSONRecordQueue;
+
 typedef StringHashMap<std::string> HTTPHeaderMap;
 
 class IHTTPContext
@@ -184,6 +187,8 @@ public:
 #endif
 public:
 	void AddRequestToQueue(IHTTPContext *context);
+	void AddFileToQueue(JSONFileContext *context);
+	void AddResumeToQueue(std::shared_ptr<JSONRecordQueue> records);
 
 	char caBundlePath[PLATFORM_MAX_PATH];
 };
@@ -212,6 +217,13 @@ public:
 	void OnHandleDestroy(HandleType_t type, void *object);
 };
 
+class JSONViewHandler : public IHandleTypeDispatch
+{
+public:
+	void OnHandleDestroy(HandleType_t type, void *object);
+	bool GetHandleApproxSize(HandleType_t type, void *object, unsigned int *size);
+};
+
 class WebSocketHandler : public IHandleTypeDispatch
 {
 public:
@@ -219,6 +231,13 @@ public:
 	bool GetHandleApproxSize(HandleType_t type, void *object, unsigned int *size);
 };
 
+class WebSocketServerHandler : public IHandleTypeDispatch
+{
+public:
+	void OnHandleDestroy(HandleType_t type, void *object);
+	bool GetHandleApproxSize(HandleType_t type, void *object, unsigned int *size);
+};
+
 extern RipExt g_RipExt;
 
 extern HTTPRequestHandler g_HTTPRequestHandler;
@@ -233,9 +252,18 @@ extern HandleType_t htJSON;
 extern JSONObjectKeysHandler g_JSONObjectKeysHandler;
 extern HandleType_t htJSONObjectKeys;
 
+extern JSONViewHandler g_JSONViewHandler;
+extern HandleType_t htJSONView;
+
 extern WebSocketHandler g_WebSocketHandler;
 extern HandleType_t htWebSocket;
 
+extern WebSocketServerHandler g_WebSocketServerHandler;
+extern HandleType_t htWebSocketServer;
+
+// ArrayList, owned by SourceMod
+extern HandleType_t htCellArray;
+
 extern const sp_nativeinfo_t http_natives[];
 extern const sp_nativeinfo_t json_natives[];
 extern const sp_nativeinfo_t websocket_natives[];
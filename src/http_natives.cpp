@@ -475,6 +475,52 @@ static cell_t PerformPostForm(IPluginContext *pContext, const cell_t *params)
 	return 1;
 }
 
+static cell_t PerformGetRecords(IPluginContext *pContext, const cell_t *params)
+{
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+
+	HTTPRequest *request = GetRequestFromHandle(pContext, params[1]);
+	if (request == nullptr)
+	{
+		return 0;
+	}
+
+	IPluginFunction *recordcallback = pContext->GetFunctionById(params[2]);
+	IPluginFunction *callback = pContext->GetFunctionById(params[3]);
+	cell_t value = params[4];
+
+	IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_String);
+	if (forward == nullptr || !forward->AddFunction(callback))
+	{
+		if (forward != nullptr)
+		{
+			forwards->ReleaseForward(forward);
+		}
+
+		pContext->ReportError("Could not create forward.");
+		return 0;
+	}
+
+	IChangeableForward *recordforward = forwards->CreateForwardEx(nullptr, ET_Ignore, 2, nullptr, Param_Cell, Param_Cell);
+	if (recordforward == nullptr || !recordforward->AddFunction(recordcallback))
+	{
+		if (recordforward != nullptr)
+		{
+			forwards->ReleaseForward(recordforward);
+		}
+		forwards->ReleaseForward(forward);
+
+		pContext->ReportError("Could not create recordcallback forward.");
+		return 0;
+	}
+
+	request->GetRecords(forward, recordforward, value);
+
+	handlesys->FreeHandle(params[1], &sec);
+
+	return 1;
+}
+
 static cell_t GetRequestConnectTimeout(IPluginContext *pContext, const cell_t *params)
 {
 	HTTPRequest *request = GetRequestFromHandle(pContext, params[1]);
@@ -611,24 +657,23 @@ static cell_t GetResponseDataLength(IPluginContext *pContext, const cell_t *para
 	return response->size;
 }
 
-static cell_t GetResponseData(IPluginContext *pContext, const cell_t *params)
+static Handle_t DecodeResponseData(IPluginContext *pContext, Handle_t hndlResponse, size_t flags)
 {
 	HandleError err;
 	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
 
 	struct HTTPResponse *response;
-	Handle_t hndlResponse = static_cast<Handle_t>(params[1]);
 	if ((err = handlesys->ReadHandle(hndlResponse, htHTTPResponse, &sec, (void **)&response)) != HandleError_None)
 	{
 		pContext->ReportError("Invalid HTTP response handle %x (error %d)", hndlResponse, err);
 		return BAD_HANDLE;
 	}
 
-	/* Return the same handle every time we get the HTTP response data */
+	/* Return the same handle every time we get the HTTP response data, the flags of the first call win */
 	if (response->hndlData == BAD_HANDLE)
 	{
 		json_error_t error;
-		response->data = json_loads(response->body, 0, &error);
+		response->data = json_loads(response->body, flags, &error);
 		if (response->data == nullptr)
 		{
 			pContext->ReportError("Invalid JSON in line %d, column %d: %s", error.line, error.column, error.text);
@@ -648,6 +693,16 @@ static cell_t GetResponseData(IPluginContext *pContext, const cell_t *params)
 	return response->hndlData;
 }
 
+static cell_t GetResponseData(IPluginContext *pContext, const cell_t *params)
+{
+	return DecodeResponseData(pContext, static_cast<Handle_t>(params[1]), 0);
+}
+
+static cell_t GetResponseDataWithFlags(IPluginContext *pContext, const cell_t *params)
+{
+	return DecodeResponseData(pContext, static_cast<Handle_t>(params[1]), static_cast<size_t>(params[2]));
+}
+
 static cell_t GetResponseStr(IPluginContext *pContext, const cell_t *params)
 {
 	HandleError err;
@@ -731,6 +786,7 @@ const sp_nativeinfo_t http_natives[] =
 		{"HTTPRequest.DownloadFile", 				PerformDownloadFile},
 		{"HTTPRequest.UploadFile", 					PerformUploadFile},
 		{"HTTPRequest.PostForm", 					PerformPostForm},
+		{"HTTPRequest.GetRecords", 					PerformGetRecords},
 		{"HTTPRequest.ConnectTimeout.get", 			GetRequestConnectTimeout},
 		{"HTTPRequest.ConnectTimeout.set", 			SetRequestConnectTimeout},
 		{"HTTPRequest.MaxRedirects.get", 			GetRequestMaxRedirects},
@@ -743,6 +799,7 @@ const sp_nativeinfo_t http_natives[] =
 		{"HTTPRequest.Timeout.set", 				SetRequestTimeout},
 		{"HTTPResponse.ResponseDataLength.get", 	GetResponseDataLength},
 		{"HTTPResponse.Data.get", 					GetResponseData},
+		{"HTTPResponse.GetData", 					GetResponseDataWithFlags},
 		{"HTTPResponse.GetResponseStr", 			GetResponseStr},
 		{"HTTPResponse.Status.get", 				GetResponseStatus},
 		{"HTTPResponse.GetHeader", 					GetResponseHeader},
@@ -0,0 +1,151 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httprecordcontext.h"
+
+static size_t ReceiveRecords(void *body, size_t size, size_t nmemb, void *userdata)
+{
+	size_t total = size * nmemb;
+	HTTPRecordContext *context = (HTTPRecordContext *)userdata;
+
+	/* Nothing is consumed while paused, cURL passes the same data again after resuming */
+	if (context->Pause())
+	{
+		return CURL_WRITEFUNC_PAUSE;
+	}
+
+	context->ReceiveData((const char *)body, total);
+
+	return total;
+}
+
+HTTPRecordContext::HTTPRecordContext(const std::string &url,
+									 struct curl_slist *headers, IChangeableForward *forward, IChangeableForward *recordForward, cell_t value,
+									 long connectTimeout, long maxRedirects, long timeout, curl_off_t maxSendSpeed, curl_off_t maxRecvSpeed,
+									 bool useBasicAuth, const std::string &username, const std::string &password, const std::string &proxy)
+	: records(std::make_shared<JSONRecordQueue>(recordForward, value)), url(url), headers(headers), forward(forward), value(value),
+	  connectTimeout(connectTimeout), maxRedirects(maxRedirects), timeout(timeout), maxSendSpeed(maxSendSpeed),
+	  maxRecvSpeed(maxRecvSpeed), useBasicAuth(useBasicAuth), username(username), password(password), proxy(proxy)
+{
+}
+
+HTTPRecordContext::~HTTPRecordContext()
+{
+	forwards->ReleaseForward(forward);
+	records->Close();
+	records->SetTransfer(nullptr);
+
+	curl_easy_cleanup(curl);
+	curl_slist_free_all(headers);
+}
+
+bool HTTPRecordContext::InitCurl()
+{
+	curl = curl_easy_init();
+	if (curl == nullptr)
+	{
+		smutils->LogError(myself, "Could not initialize cURL session.");
+		return false;
+	}
+
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+	curl_easy_setopt(curl, CURLOPT_CAINFO, g_RipExt.caBundlePath);
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, connectTimeout);
+	curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, error);
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+	curl_easy_setopt(curl, CURLOPT_MAXREDIRS, maxRedirects);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, this);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
+	curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, SM_RIPEXT_USER_AGENT);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &ReceiveRecords);
+
+	records->SetTransfer(curl);
+
+	if (maxRecvSpeed > 0)
+	{
+		curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE, maxRecvSpeed);
+	}
+	if (maxSendSpeed > 0)
+	{
+		curl_easy_setopt(curl, CURLOPT_MAX_SEND_SPEED_LARGE, maxSendSpeed);
+	}
+	if (useBasicAuth)
+	{
+		curl_easy_setopt(curl, CURLOPT_USERNAME, username.c_str());
+		curl_easy_setopt(curl, CURLOPT_PASSWORD, password.c_str());
+	}
+	if (!proxy.empty())
+	{
+		curl_easy_setopt(curl, CURLOPT_PROXY, proxy.c_str());
+	}
+
+#ifdef WIN32
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+#endif
+
+#ifdef DEBUG
+	curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+#endif
+
+	return true;
+}
+
+bool HTTPRecordContext::Pause()
+{
+	return records->Pause();
+}
+
+void HTTPRecordContext::ReceiveData(const char *data, size_t size)
+{
+	parser.Feed(data, size, [this](json_t *record, size_t length) {
+		records->Push(record, length);
+	});
+}
+
+void HTTPRecordContext::OnCompleted()
+{
+	/* The transfer is done, so the parser is no longer used by the event loop */
+	parser.Finish([this](json_t *record, size_t length) {
+		records->Push(record, length);
+	});
+
+	/* Deliver the records still queued before the completion callback */
+	records->Flush();
+
+	/* Return early if the plugin was unloaded while the thread was running */
+	if (forward->GetFunctionCount() == 0)
+	{
+		return;
+	}
+
+	long status;
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+	forward->PushCell(status);
+	forward->PushCell(value);
+	forward->PushString(error);
+	forward->Execute(nullptr);
+}
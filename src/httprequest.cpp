@@ -23,6 +23,7 @@
 #include "httprequestcontext.h"
 #include "httpfilecontext.h"
 #include "httpformcontext.h"
+#include "httprecordcontext.h"
 
 HTTPRequest::HTTPRequest(const std::string &url)
 	: url(url)
@@ -72,6 +73,20 @@ void HTTPRequest::PostForm(IChangeableForward *forward, cell_t value)
 	g_RipExt.AddRequestToQueue(context);
 }
 
+void HTTPRequest::GetRecords(IChangeableForward *forward, IChangeableForward *recordForward, cell_t value)
+{
+	/* Some servers only stream records for their own media type, a plugin may have set it */
+	if (!headers.contains("Accept"))
+	{
+		SetHeader("Accept", "application/x-ndjson");
+	}
+
+	HTTPRecordContext *context = new HTTPRecordContext(BuildURL(), BuildHeaders(), forward, recordForward, value,
+													   connectTimeout, maxRedirects, timeout, maxSendSpeed, maxRecvSpeed, useBasicAuth, username, password, proxy);
+
+	g_RipExt.AddRequestToQueue(context);
+}
+
 const std::string HTTPRequest::BuildURL() const
 {
 	std::string url(this->url);
@@ -33,6 +33,7 @@ public:
 	void DownloadFile(const char *path, IChangeableForward *forward, IChangeableForward *progressForward, cell_t value);
 	void UploadFile(const char *path, IChangeableForward *forward, IChangeableForward *progressForward, cell_t value);
 	void PostForm(IChangeableForward *forward, cell_t value);
+	void GetRecords(IChangeableForward *forward, IChangeableForward *recordForward, cell_t value);
 
 	const std::string BuildURL() const;
 	void AppendQueryParam(const char *name, const char *value);
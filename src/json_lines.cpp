@@ -0,0 +1,209 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json_lines.h"
+
+void JSONLineParser::Feed(const char *data, size_t size, const RecordCallback &callback)
+{
+	const char *end = data + size;
+	while (data < end)
+	{
+		const char *newline = (const char *)memchr(data, '\n', end - data);
+		if (newline == nullptr)
+		{
+			partial.append(data, end - data);
+			return;
+		}
+
+		// Lines that arrived in one piece are parsed in place, without a copy
+		if (partial.empty())
+		{
+			ParseLine(data, newline - data, callback);
+		}
+		else
+		{
+			partial.append(data, newline - data);
+			ParseLine(partial.data(), partial.size(), callback);
+			partial.clear();
+		}
+
+		data = newline + 1;
+	}
+}
+
+void JSONLineParser::Finish(const RecordCallback &callback)
+{
+	if (!partial.empty())
+	{
+		ParseLine(partial.data(), partial.size(), callback);
+	}
+
+	std::string().swap(partial);
+}
+
+void JSONLineParser::ParseLine(const char *line, size_t length, const RecordCallback &callback)
+{
+	lineNumber++;
+
+	while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t'))
+	{
+		length--;
+	}
+	if (length == 0)
+	{
+		return;
+	}
+
+	json_error_t error;
+	json_t *record = json_loadb(line, length, JSON_DECODE_ANY, &error);
+	if (record == nullptr)
+	{
+		g_RipExt.LogError("Invalid JSON record on line %u: %s", lineNumber, error.text);
+		return;
+	}
+
+	callback(record, length);
+}
+
+JSONRecordQueue::JSONRecordQueue(IChangeableForward *forward, cell_t value)
+	: forward(forward), value(value)
+{
+	uv_mutex_init(&mutex);
+	uv_mutex_init(&transferMutex);
+}
+
+JSONRecordQueue::~JSONRecordQueue()
+{
+	for (json_t *record : records)
+	{
+		json_decref(record);
+	}
+
+	if (forward != nullptr)
+	{
+		forwards->ReleaseForward(forward);
+	}
+
+	uv_mutex_destroy(&mutex);
+	uv_mutex_destroy(&transferMutex);
+}
+
+void JSONRecordQueue::Push(json_t *record, size_t length)
+{
+	uv_mutex_lock(&mutex);
+	records.push_back(record);
+	queuedBytes += length;
+
+	// One flush per frame picks up everything that arrived in the meantime
+	bool schedule = !scheduled;
+	scheduled = true;
+	uv_mutex_unlock(&mutex);
+
+	if (schedule)
+	{
+		std::shared_ptr<JSONRecordQueue> self = shared_from_this();
+		g_RipExt.Defer([self]() {
+			self->Flush();
+		});
+	}
+}
+
+void JSONRecordQueue::Flush()
+{
+	std::vector<json_t *> batch;
+
+	uv_mutex_lock(&mutex);
+	batch.swap(records);
+	queuedBytes = 0;
+	scheduled = false;
+	bool resume = paused;
+	paused = false;
+	uv_mutex_unlock(&mutex);
+
+	if (resume)
+	{
+		g_RipExt.AddResumeToQueue(shared_from_this());
+	}
+
+	HandleSecurity sec(nullptr, myself->GetIdentity());
+	for (json_t *record : batch)
+	{
+		/* Drop the rest if the plugin was unloaded */
+		if (forward == nullptr || forward->GetFunctionCount() == 0)
+		{
+			json_decref(record);
+			continue;
+		}
+
+		HandleError err;
+		Handle_t hndlRecord = handlesys->CreateHandleEx(htJSON, record, &sec, nullptr, &err);
+		if (hndlRecord == BAD_HANDLE)
+		{
+			json_decref(record);
+
+			smutils->LogError(myself, "Could not create record handle (error %d)", err);
+			continue;
+		}
+
+		forward->PushCell(hndlRecord);
+		forward->PushCell(value);
+		forward->Execute(nullptr);
+
+		handlesys->FreeHandle(hndlRecord, &sec);
+	}
+}
+
+bool JSONRecordQueue::Pause()
+{
+	uv_mutex_lock(&mutex);
+	// Only a non-empty queue can be over budget, so a flush is always scheduled to resume
+	paused = records.size() >= SM_RIPEXT_RECORD_QUEUE_MAX_RECORDS || queuedBytes >= SM_RIPEXT_RECORD_QUEUE_MAX_BYTES;
+	bool result = paused;
+	uv_mutex_unlock(&mutex);
+
+	return result;
+}
+
+void JSONRecordQueue::SetTransfer(CURL *curl)
+{
+	uv_mutex_lock(&transferMutex);
+	transfer = curl;
+	uv_mutex_unlock(&transferMutex);
+}
+
+void JSONRecordQueue::Resume()
+{
+	uv_mutex_lock(&transferMutex);
+	if (transfer != nullptr)
+	{
+		curl_easy_pause(transfer, CURLPAUSE_CONT);
+	}
+	uv_mutex_unlock(&transferMutex);
+}
+
+void JSONRecordQueue::Close()
+{
+	if (forward != nullptr)
+	{
+		forwards->ReleaseForward(forward);
+		forward = nullptr;
+	}
+}
@@ -0,0 +1,96 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SM_RIPEXT_JSONLINES_H_
+#define SM_RIPEXT_JSONLINES_H_
+
+#include "extension.h"
+#include <vector>
+
+/* Records waiting for the game thread before a transfer is paused */
+#define SM_RIPEXT_RECORD_QUEUE_MAX_RECORDS 4096
+#define SM_RIPEXT_RECORD_QUEUE_MAX_BYTES 1048576
+
+// Splits newline-delimited JSON (NDJSON, JSON Lines) into records as data arrives.
+// Only an incomplete last line is buffered, so memory is bounded by the largest record.
+class JSONLineParser
+{
+public:
+	typedef std::function<void(json_t *record, size_t length)> RecordCallback;
+
+	// Parses every complete line in data. The callback takes the reference to each record
+	// and gets the length of its line.
+	// Blank lines are skipped, invalid ones are logged and skipped.
+	void Feed(const char *data, size_t size, const RecordCallback &callback);
+
+	// Parses a last line that was not terminated by a newline.
+	void Finish(const RecordCallback &callback);
+
+private:
+	void ParseLine(const char *line, size_t length, const RecordCallback &callback);
+
+	std::string partial;
+	unsigned int lineNumber = 0;
+};
+
+// Records parsed off the game thread, delivered to a forward in one batch per frame.
+// When frames stop the queue fills up to its budget and the transfer is paused, the
+// flush that drains it resumes the transfer on the event loop.
+class JSONRecordQueue : public std::enable_shared_from_this<JSONRecordQueue>
+{
+public:
+	JSONRecordQueue(IChangeableForward *forward, cell_t value);
+	~JSONRecordQueue();
+
+	// Takes the reference to record, length is the size of its text. Safe to call from any thread.
+	void Push(json_t *record, size_t length);
+
+	// Returns true and marks the transfer as paused if the budget is used up. Event loop only.
+	bool Pause();
+
+	// Sets the transfer resumed after a flush, nullptr once it is cleaned up. Game thread only.
+	void SetTransfer(CURL *curl);
+
+	// Resumes the paused transfer. Event loop only.
+	void Resume();
+
+	// Calls the forward for every queued record. Game thread only.
+	void Flush();
+
+	// Releases the forward, records pushed or flushed afterwards are dropped. Game thread only.
+	void Close();
+
+private:
+	uv_mutex_t mutex;
+	std::vector<json_t *> records;
+	size_t queuedBytes = 0;
+	bool scheduled = false;
+	bool paused = false;
+
+	/* Separate from mutex, resuming can call the write callback that pushes records */
+	uv_mutex_t transferMutex;
+	CURL *transfer = nullptr;
+
+	IChangeableForward *forward;
+	cell_t value;
+};
+
+#endif // SM_RIPEXT_JSONLINES_H_
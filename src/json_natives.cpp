@@ -20,6 +20,13 @@
  */
 
 #include "extension.h"
+#include "json_pack.h"
+#include "json_patch.h"
+#include "json_path.h"
+#include "json_view.h"
+#include "jsonfilecontext.h"
+#include <ICellArray.h>
+#include <algorithm>
 
 static json_t *GetJSONFromHandle(IPluginContext *pContext, Handle_t hndl)
 {
@@ -249,6 +256,26 @@ static cell_t IsObjectKeyValid(IPluginContext *pContext, const cell_t *params)
 	return json_object_get(object, key) != nullptr;
 }
 
+static cell_t GetObjectValueType(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return -1;
+	}
+
+	char *key;
+	pContext->LocalToString(params[2], &key);
+
+	json_t *value = json_object_get(object, key);
+	if (value == nullptr)
+	{
+		return -1;
+	}
+
+	return json_typeof(value);
+}
+
 static cell_t SetObjectValue(IPluginContext *pContext, const cell_t *params)
 {
 	json_t *object = GetJSONFromHandle(pContext, params[1]);
@@ -879,6 +906,487 @@ static cell_t ClearArray(IPluginContext *pContext, const cell_t *params)
 	return (json_array_clear(object) == 0);
 }
 
+static bool GetArrayRange(IPluginContext *pContext, json_t *object, cell_t start, cell_t maxsize, size_t *count)
+{
+	size_t size = json_array_size(object);
+	if (start < 0 || (size_t)start > size)
+	{
+		pContext->ReportError("Invalid start index %d (array size %u)", start, (unsigned int)size);
+		return false;
+	}
+
+	if (maxsize < 0)
+	{
+		pContext->ReportError("Invalid maximum size %d", maxsize);
+		return false;
+	}
+
+	*count = std::min(size - (size_t)start, (size_t)maxsize);
+	return true;
+}
+
+static cell_t GetArrayInts(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[2], &values);
+
+	size_t start = (size_t)params[4], count;
+	if (!GetArrayRange(pContext, object, params[4], params[3], &count))
+	{
+		return 0;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		values[i] = static_cast<cell_t>(json_integer_value(json_array_get(object, start + i)));
+	}
+
+	return static_cast<cell_t>(count);
+}
+
+static cell_t GetArrayFloats(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[2], &values);
+
+	size_t start = (size_t)params[4], count;
+	if (!GetArrayRange(pContext, object, params[4], params[3], &count))
+	{
+		return 0;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		values[i] = sp_ftoc(static_cast<float>(json_number_value(json_array_get(object, start + i))));
+	}
+
+	return static_cast<cell_t>(count);
+}
+
+static cell_t GetArrayBools(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[2], &values);
+
+	size_t start = (size_t)params[4], count;
+	if (!GetArrayRange(pContext, object, params[4], params[3], &count))
+	{
+		return 0;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		values[i] = json_is_true(json_array_get(object, start + i));
+	}
+
+	return static_cast<cell_t>(count);
+}
+
+static cell_t GetArrayStrings(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	// The strings are rows of a 2D array, found through its indirection vector
+	cell_t *rows;
+	pContext->LocalToPhysAddr(params[2], &rows);
+
+	size_t start = (size_t)params[5], count;
+	if (!GetArrayRange(pContext, object, params[5], params[3], &count))
+	{
+		return 0;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const char *value = json_string_value(json_array_get(object, start + i));
+		pContext->StringToLocalUTF8(rows[i], params[4], value != nullptr ? value : "", nullptr);
+	}
+
+	return static_cast<cell_t>(count);
+}
+
+static cell_t PushArrayInts(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[2], &values);
+
+	for (cell_t i = 0; i < params[3]; i++)
+	{
+		if (json_array_append_new(object, json_integer(values[i])) != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static cell_t PushArrayFloats(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[2], &values);
+
+	for (cell_t i = 0; i < params[3]; i++)
+	{
+		if (json_array_append_new(object, json_real(sp_ctof(values[i]))) != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static cell_t PushArrayBools(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[2], &values);
+
+	for (cell_t i = 0; i < params[3]; i++)
+	{
+		if (json_array_append_new(object, json_boolean(values[i])) != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static bool IsArrayRangeValid(json_t *object, cell_t start, cell_t size)
+{
+	return start >= 0 && size >= 0 && (size_t)start + (size_t)size <= json_array_size(object);
+}
+
+static cell_t SetArrayInts(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t start = params[2];
+	if (!IsArrayRangeValid(object, start, params[4]))
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[3], &values);
+
+	for (cell_t i = 0; i < params[4]; i++)
+	{
+		if (json_array_set_new(object, start + i, json_integer(values[i])) != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static cell_t SetArrayFloats(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t start = params[2];
+	if (!IsArrayRangeValid(object, start, params[4]))
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[3], &values);
+
+	for (cell_t i = 0; i < params[4]; i++)
+	{
+		if (json_array_set_new(object, start + i, json_real(sp_ctof(values[i]))) != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static cell_t SetArrayBools(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	cell_t start = params[2];
+	if (!IsArrayRangeValid(object, start, params[4]))
+	{
+		return 0;
+	}
+
+	cell_t *values;
+	pContext->LocalToPhysAddr(params[3], &values);
+
+	for (cell_t i = 0; i < params[4]; i++)
+	{
+		if (json_array_set_new(object, start + i, json_boolean(values[i])) != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static ICellArray *GetArrayListFromHandle(IPluginContext *pContext, Handle_t hndl)
+{
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+
+	ICellArray *list;
+	if ((err = handlesys->ReadHandle(hndl, htCellArray, &sec, (void **)&list)) != HandleError_None)
+	{
+		pContext->ReportError("Invalid ArrayList handle %x (error %d)", hndl, err);
+		return nullptr;
+	}
+
+	return list;
+}
+
+// Numbers, booleans and null take a single cell, strings and arrays of those are spread over the block.
+static bool IsArrayListValue(json_t *value, bool nested)
+{
+	switch (json_typeof(value))
+	{
+	case JSON_INTEGER:
+	case JSON_REAL:
+	case JSON_TRUE:
+	case JSON_FALSE:
+	case JSON_NULL:
+		return true;
+
+	case JSON_STRING:
+		return !nested;
+
+	case JSON_ARRAY:
+		if (nested)
+		{
+			return false;
+		}
+
+		size_t index;
+		json_t *element;
+		json_array_foreach(value, index, element)
+		{
+			if (!IsArrayListValue(element, true))
+			{
+				return false;
+			}
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static cell_t ValueToCell(json_t *value)
+{
+	switch (json_typeof(value))
+	{
+	case JSON_INTEGER:
+		return static_cast<cell_t>(json_integer_value(value));
+	case JSON_REAL:
+		return sp_ftoc(static_cast<float>(json_real_value(value)));
+	case JSON_TRUE:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static json_t *CellToValue(cell_t value, json_type type)
+{
+	switch (type)
+	{
+	case JSON_REAL:
+		return json_real(sp_ctof(value));
+	case JSON_TRUE:
+	case JSON_FALSE:
+		return json_boolean(value);
+	default:
+		return json_integer(value);
+	}
+}
+
+static cell_t ArrayToArrayList(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	ICellArray *list = GetArrayListFromHandle(pContext, params[2]);
+	if (list == nullptr)
+	{
+		return 0;
+	}
+
+	// Check everything first, so the list is left untouched on error
+	size_t index;
+	json_t *value;
+	json_array_foreach(object, index, value)
+	{
+		if (!IsArrayListValue(value, false))
+		{
+			pContext->ReportError("Value at index %d can't be stored in an ArrayList", (int)index);
+			return 0;
+		}
+	}
+
+	// Longer strings and arrays are truncated to the block size, like ArrayList.PushString and PushArray
+	size_t blocksize = list->blocksize();
+	json_array_foreach(object, index, value)
+	{
+		cell_t *block = list->push();
+		if (block == nullptr)
+		{
+			pContext->ReportError("Could not grow ArrayList");
+			return 0;
+		}
+		memset(block, 0, blocksize * sizeof(cell_t));
+
+		if (json_is_string(value))
+		{
+			size_t length = std::min(json_string_length(value), blocksize * sizeof(cell_t) - 1);
+			memcpy(block, json_string_value(value), length);
+		}
+		else if (json_is_array(value))
+		{
+			size_t count = std::min(json_array_size(value), blocksize);
+			for (size_t i = 0; i < count; i++)
+			{
+				block[i] = ValueToCell(json_array_get(value, i));
+			}
+		}
+		else
+		{
+			block[0] = ValueToCell(value);
+		}
+	}
+
+	return static_cast<cell_t>(json_array_size(object));
+}
+
+static cell_t ArrayFromArrayList(IPluginContext *pContext, const cell_t *params)
+{
+	ICellArray *list = GetArrayListFromHandle(pContext, params[1]);
+	if (list == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	json_type type = static_cast<json_type>(params[2]);
+	if (type != JSON_STRING && type != JSON_INTEGER && type != JSON_REAL && type != JSON_TRUE && type != JSON_FALSE)
+	{
+		pContext->ReportError("Invalid ArrayList element type %d", params[2]);
+		return BAD_HANDLE;
+	}
+
+	json_t *object = json_array();
+	size_t blocksize = list->blocksize();
+	for (size_t i = 0; i < list->size(); i++)
+	{
+		const cell_t *block = list->at(i);
+
+		json_t *value;
+		if (type == JSON_STRING)
+		{
+			const char *string = reinterpret_cast<const char *>(block);
+			value = json_stringn(string, strnlen(string, blocksize * sizeof(cell_t)));
+		}
+		else if (blocksize == 1)
+		{
+			value = CellToValue(block[0], type);
+		}
+		else
+		{
+			// Wider blocks become nested arrays, one element per cell
+			value = json_array();
+			for (size_t j = 0; j < blocksize; j++)
+			{
+				json_array_append_new(value, CellToValue(block[j], type));
+			}
+		}
+
+		if (json_array_append_new(object, value) != 0)
+		{
+			json_decref(object);
+
+			pContext->ReportError("Could not convert ArrayList index %d", (int)i);
+			return BAD_HANDLE;
+		}
+	}
+
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+	Handle_t hndlObject = handlesys->CreateHandleEx(htJSON, object, &sec, nullptr, &err);
+	if (hndlObject == BAD_HANDLE)
+	{
+		json_decref(object);
+
+		pContext->ReportError("Could not create array handle (error %d)", err);
+		return BAD_HANDLE;
+	}
+
+	return hndlObject;
+}
+
 static cell_t FromString(IPluginContext *pContext, const cell_t *params)
 {
 	char *buffer;
@@ -981,6 +1489,698 @@ static cell_t ToFile(IPluginContext *pContext, const cell_t *params)
 	return (json_dump_file(object, realpath, flags) == 0);
 }
 
+static cell_t LoadFileAsync(IPluginContext *pContext, const cell_t *params)
+{
+	char *path;
+	pContext->LocalToString(params[1], &path);
+
+	char realpath[PLATFORM_MAX_PATH];
+	smutils->BuildPath(Path_Game, realpath, sizeof(realpath), "%s", path);
+
+	IPluginFunction *callback = pContext->GetFunctionById(params[2]);
+	cell_t value = params[3];
+	size_t flags = (size_t)params[4];
+
+	IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_String);
+	if (forward == nullptr || !forward->AddFunction(callback))
+	{
+		pContext->ReportError("Could not create forward.");
+		return 0;
+	}
+
+	g_RipExt.AddFileToQueue(new JSONFileContext(realpath, nullptr, flags, pContext->GetIdentity(), forward, value));
+
+	return 1;
+}
+
+static cell_t SaveFileAsync(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	char *path;
+	pContext->LocalToString(params[2], &path);
+
+	char realpath[PLATFORM_MAX_PATH];
+	smutils->BuildPath(Path_Game, realpath, sizeof(realpath), "%s", path);
+
+	IPluginFunction *callback = pContext->GetFunctionById(params[3]);
+	cell_t value = params[4];
+	size_t flags = (size_t)params[5];
+
+	/* Snapshot the value so the plugin can keep changing it while the file is written */
+	json_t *copy = json_deep_copy(object);
+	if (copy == nullptr)
+	{
+		pContext->ReportError("Could not copy JSON for saving.");
+		return 0;
+	}
+
+	IChangeableForward *forward = forwards->CreateForwardEx(nullptr, ET_Ignore, 3, nullptr, Param_Cell, Param_Cell, Param_String);
+	if (forward == nullptr || !forward->AddFunction(callback))
+	{
+		json_decref(copy);
+
+		pContext->ReportError("Could not create forward.");
+		return 0;
+	}
+
+	g_RipExt.AddFileToQueue(new JSONFileContext(realpath, copy, flags, pContext->GetIdentity(), forward, value));
+
+	return 1;
+}
+
+static std::shared_ptr<const JSONPath> GetPathFromParam(IPluginContext *pContext, cell_t param, char **path)
+{
+	pContext->LocalToString(param, path);
+
+	std::string error;
+	std::shared_ptr<const JSONPath> compiled = JSONPath::Compile(*path, error);
+	if (compiled == nullptr)
+	{
+		pContext->ReportError("Invalid JSON path '%s': %s", *path, error.c_str());
+	}
+
+	return compiled;
+}
+
+static json_t *GetValueByPath(IPluginContext *pContext, const cell_t *params, bool required)
+{
+	json_t *root = GetJSONFromHandle(pContext, params[1]);
+	if (root == nullptr)
+	{
+		return nullptr;
+	}
+
+	char *path;
+	std::shared_ptr<const JSONPath> compiled = GetPathFromParam(pContext, params[2], &path);
+	if (compiled == nullptr)
+	{
+		return nullptr;
+	}
+
+	json_t *value = compiled->Get(root);
+	if (value == nullptr && required)
+	{
+		pContext->ReportError("Could not retrieve value at path '%s'", path);
+	}
+
+	return value;
+}
+
+static cell_t SetValueByPath(IPluginContext *pContext, const cell_t *params, json_t *value)
+{
+	json_t *root = GetJSONFromHandle(pContext, params[1]);
+	if (root == nullptr)
+	{
+		json_decref(value);
+		return 0;
+	}
+
+	char *path;
+	std::shared_ptr<const JSONPath> compiled = GetPathFromParam(pContext, params[2], &path);
+	if (compiled == nullptr)
+	{
+		json_decref(value);
+		return 0;
+	}
+
+	return compiled->Set(root, value);
+}
+
+static cell_t GetValueAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetValueByPath(pContext, params, true);
+	if (value == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+	Handle_t hndlValue = handlesys->CreateHandleEx(htJSON, value, &sec, nullptr, &err);
+	if (hndlValue == BAD_HANDLE)
+	{
+		pContext->ReportError("Could not create value handle (error %d)", err);
+		return BAD_HANDLE;
+	}
+
+	json_incref(value);
+
+	return hndlValue;
+}
+
+static cell_t GetBoolAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetValueByPath(pContext, params, true);
+	if (value == nullptr)
+	{
+		return 0;
+	}
+
+	return json_boolean_value(value);
+}
+
+static cell_t GetFloatAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetValueByPath(pContext, params, true);
+	if (value == nullptr)
+	{
+		return 0;
+	}
+
+	return sp_ftoc(static_cast<float>(json_number_value(value)));
+}
+
+static cell_t GetIntAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetValueByPath(pContext, params, true);
+	if (value == nullptr)
+	{
+		return 0;
+	}
+
+	return static_cast<cell_t>(json_integer_value(value));
+}
+
+static cell_t GetInt64AtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetValueByPath(pContext, params, false);
+	if (value == nullptr)
+	{
+		return 0;
+	}
+
+	char result[20];
+	snprintf(result, sizeof(result), "%" JSON_INTEGER_FORMAT, json_integer_value(value));
+	pContext->StringToLocalUTF8(params[3], params[4], result, nullptr);
+
+	return 1;
+}
+
+static cell_t GetStringAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetValueByPath(pContext, params, false);
+	if (value == nullptr)
+	{
+		return 0;
+	}
+
+	const char *result = json_string_value(value);
+	if (result == nullptr)
+	{
+		return 0;
+	}
+
+	pContext->StringToLocalUTF8(params[3], params[4], result, nullptr);
+
+	return 1;
+}
+
+static cell_t IsNullAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetValueByPath(pContext, params, true);
+	if (value == nullptr)
+	{
+		return 0;
+	}
+
+	return json_is_null(value);
+}
+
+static cell_t HasPath(IPluginContext *pContext, const cell_t *params)
+{
+	return GetValueByPath(pContext, params, false) != nullptr;
+}
+
+static cell_t SetValueAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *value = GetJSONFromHandle(pContext, params[3]);
+	if (value == nullptr)
+	{
+		return 0;
+	}
+
+	return SetValueByPath(pContext, params, json_incref(value));
+}
+
+static cell_t SetBoolAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	return SetValueByPath(pContext, params, json_boolean(params[3]));
+}
+
+static cell_t SetFloatAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	return SetValueByPath(pContext, params, json_real(sp_ctof(params[3])));
+}
+
+static cell_t SetIntAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	return SetValueByPath(pContext, params, json_integer(params[3]));
+}
+
+static cell_t SetInt64AtPath(IPluginContext *pContext, const cell_t *params)
+{
+	char *val;
+	pContext->LocalToString(params[3], &val);
+
+	return SetValueByPath(pContext, params, json_integer(strtoll(val, nullptr, 10)));
+}
+
+static cell_t SetStringAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	char *val;
+	pContext->LocalToString(params[3], &val);
+
+	return SetValueByPath(pContext, params, json_string(val));
+}
+
+static cell_t SetNullAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	return SetValueByPath(pContext, params, json_null());
+}
+
+static cell_t RemoveAtPath(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *root = GetJSONFromHandle(pContext, params[1]);
+	if (root == nullptr)
+	{
+		return 0;
+	}
+
+	char *path;
+	std::shared_ptr<const JSONPath> compiled = GetPathFromParam(pContext, params[2], &path);
+	if (compiled == nullptr)
+	{
+		return 0;
+	}
+
+	return compiled->Remove(root);
+}
+
+static cell_t Unpack(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *object = GetJSONFromHandle(pContext, params[1]);
+	if (object == nullptr)
+	{
+		return 0;
+	}
+
+	char *format;
+	pContext->LocalToString(params[2], &format);
+
+	JSONUnpacker unpacker(pContext, params, 3);
+	if (!unpacker.Unpack(object, format))
+	{
+		if (unpacker.HasFormatError())
+		{
+			pContext->ReportError("Invalid unpack format '%s': %s", format, unpacker.GetError().c_str());
+		}
+		return 0;
+	}
+
+	return 1;
+}
+
+static cell_t Pack(IPluginContext *pContext, const cell_t *params)
+{
+	char *format;
+	pContext->LocalToString(params[1], &format);
+
+	JSONPacker packer(pContext, params, 2);
+	json_t *object = packer.Pack(format);
+	if (object == nullptr)
+	{
+		pContext->ReportError("Could not pack '%s': %s", format, packer.GetError().c_str());
+		return BAD_HANDLE;
+	}
+
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+	Handle_t hndlObject = handlesys->CreateHandleEx(htJSON, object, &sec, nullptr, &err);
+	if (hndlObject == BAD_HANDLE)
+	{
+		json_decref(object);
+
+		pContext->ReportError("Could not create object handle (error %d)", err);
+		return BAD_HANDLE;
+	}
+
+	return hndlObject;
+}
+
+static Handle_t CreatePatchHandle(IPluginContext *pContext, json_t *patch)
+{
+	if (patch == nullptr)
+	{
+		pContext->ReportError("Could not create patch");
+		return BAD_HANDLE;
+	}
+
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+	Handle_t hndlPatch = handlesys->CreateHandleEx(htJSON, patch, &sec, nullptr, &err);
+	if (hndlPatch == BAD_HANDLE)
+	{
+		json_decref(patch);
+
+		pContext->ReportError("Could not create patch handle (error %d)", err);
+		return BAD_HANDLE;
+	}
+
+	return hndlPatch;
+}
+
+static cell_t Diff(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *from = GetJSONFromHandle(pContext, params[1]);
+	if (from == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	json_t *to = GetJSONFromHandle(pContext, params[2]);
+	if (to == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	return CreatePatchHandle(pContext, JSONPatch::Diff(from, to));
+}
+
+static cell_t MergeDiff(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *from = GetJSONFromHandle(pContext, params[1]);
+	if (from == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	json_t *to = GetJSONFromHandle(pContext, params[2]);
+	if (to == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	return CreatePatchHandle(pContext, JSONPatch::MergeDiff(from, to));
+}
+
+static cell_t ApplyPatch(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *root = GetJSONFromHandle(pContext, params[1]);
+	if (root == nullptr)
+	{
+		return 0;
+	}
+
+	json_t *patch = GetJSONFromHandle(pContext, params[2]);
+	if (patch == nullptr)
+	{
+		return 0;
+	}
+
+	std::string error;
+	if (!JSONPatch::Apply(root, patch, error))
+	{
+		if (params[4] > 0)
+		{
+			pContext->StringToLocalUTF8(params[3], params[4], error.c_str(), nullptr);
+		}
+		return 0;
+	}
+
+	return 1;
+}
+
+static cell_t ApplyMergePatch(IPluginContext *pContext, const cell_t *params)
+{
+	json_t *root = GetJSONFromHandle(pContext, params[1]);
+	if (root == nullptr)
+	{
+		return 0;
+	}
+
+	json_t *patch = GetJSONFromHandle(pContext, params[2]);
+	if (patch == nullptr)
+	{
+		return 0;
+	}
+
+	std::string error;
+	if (!JSONPatch::ApplyMerge(root, patch, error))
+	{
+		if (params[4] > 0)
+		{
+			pContext->StringToLocalUTF8(params[3], params[4], error.c_str(), nullptr);
+		}
+		return 0;
+	}
+
+	return 1;
+}
+
+static struct JSONView *GetViewFromHandle(IPluginContext *pContext, Handle_t hndl)
+{
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+
+	struct JSONView *view;
+	if ((err = handlesys->ReadHandle(hndl, htJSONView, &sec, (void **)&view)) != HandleError_None)
+	{
+		pContext->ReportError("Invalid JSON view handle %x (error %d)", hndl, err);
+		return nullptr;
+	}
+
+	return view;
+}
+
+static Handle_t CreateViewHandle(IPluginContext *pContext, const std::shared_ptr<JSONViewDocument> &document, uint32_t index)
+{
+	struct JSONView *view = new JSONView{document, index};
+
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+	Handle_t hndlView = handlesys->CreateHandleEx(htJSONView, view, &sec, nullptr, &err);
+	if (hndlView == BAD_HANDLE)
+	{
+		delete view;
+
+		pContext->ReportError("Could not create view handle (error %d)", err);
+		return BAD_HANDLE;
+	}
+
+	return hndlView;
+}
+
+// Resolves the view handle in params[1] and the path in params[2] to a tape index.
+static const JSONViewDocument *GetViewNodeByPath(IPluginContext *pContext, const cell_t *params, bool required, uint32_t *index)
+{
+	struct JSONView *view = GetViewFromHandle(pContext, params[1]);
+	if (view == nullptr)
+	{
+		return nullptr;
+	}
+
+	char *path;
+	std::shared_ptr<const JSONPath> compiled = GetPathFromParam(pContext, params[2], &path);
+	if (compiled == nullptr)
+	{
+		return nullptr;
+	}
+
+	*index = view->document->Find(view->index, *compiled);
+	if (*index == JSONViewDocument::npos)
+	{
+		if (required)
+		{
+			pContext->ReportError("Could not retrieve value at path '%s'", path);
+		}
+		return nullptr;
+	}
+
+	return view->document.get();
+}
+
+static cell_t ViewFromString(IPluginContext *pContext, const cell_t *params)
+{
+	char *buffer;
+	pContext->LocalToString(params[1], &buffer);
+
+	std::string error;
+	std::shared_ptr<JSONViewDocument> document = JSONViewDocument::Parse(buffer, strlen(buffer), error);
+	if (document == nullptr)
+	{
+		pContext->ReportError("Invalid JSON: %s", error.c_str());
+		return BAD_HANDLE;
+	}
+
+	return CreateViewHandle(pContext, document, 0);
+}
+
+static cell_t GetViewValue(IPluginContext *pContext, const cell_t *params)
+{
+	struct JSONView *view = GetViewFromHandle(pContext, params[1]);
+	if (view == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	uint32_t index;
+	if (GetViewNodeByPath(pContext, params, true, &index) == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	return CreateViewHandle(pContext, view->document, index);
+}
+
+static cell_t GetViewBool(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, true, &index);
+	if (document == nullptr)
+	{
+		return 0;
+	}
+
+	return document->GetNode(index).type == JSONView_True;
+}
+
+static cell_t GetViewFloat(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, true, &index);
+	if (document == nullptr)
+	{
+		return 0;
+	}
+
+	uint8_t type = document->GetNode(index).type;
+	if (type != JSONView_Integer && type != JSONView_Real)
+	{
+		return sp_ftoc(0.0f);
+	}
+
+	return sp_ftoc(static_cast<float>(document->GetNumber(index)));
+}
+
+static cell_t GetViewInt(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, true, &index);
+	if (document == nullptr || document->GetNode(index).type != JSONView_Integer)
+	{
+		return 0;
+	}
+
+	return static_cast<cell_t>(document->GetInteger(index));
+}
+
+static cell_t GetViewInt64(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, false, &index);
+	if (document == nullptr || document->GetNode(index).type != JSONView_Integer)
+	{
+		return 0;
+	}
+
+	char result[20];
+	snprintf(result, sizeof(result), "%" JSON_INTEGER_FORMAT, document->GetInteger(index));
+	pContext->StringToLocalUTF8(params[3], params[4], result, nullptr);
+
+	return 1;
+}
+
+static cell_t GetViewString(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, false, &index);
+	if (document == nullptr || document->GetNode(index).type != JSONView_String)
+	{
+		return 0;
+	}
+
+	pContext->StringToLocalUTF8(params[3], params[4], document->GetString(index).c_str(), nullptr);
+
+	return 1;
+}
+
+static cell_t IsViewNull(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, true, &index);
+	if (document == nullptr)
+	{
+		return 0;
+	}
+
+	return document->GetNode(index).type == JSONView_Null;
+}
+
+static cell_t HasViewPath(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	return GetViewNodeByPath(pContext, params, false, &index) != nullptr;
+}
+
+static cell_t GetViewType(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, true, &index);
+	if (document == nullptr)
+	{
+		return 0;
+	}
+
+	return document->GetNode(index).type;
+}
+
+static cell_t GetViewSize(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, true, &index);
+	if (document == nullptr)
+	{
+		return 0;
+	}
+
+	return static_cast<cell_t>(document->GetNode(index).count);
+}
+
+static cell_t ViewToJSON(IPluginContext *pContext, const cell_t *params)
+{
+	uint32_t index;
+	const JSONViewDocument *document = GetViewNodeByPath(pContext, params, true, &index);
+	if (document == nullptr)
+	{
+		return BAD_HANDLE;
+	}
+
+	json_t *object = document->ToJSON(index);
+	if (object == nullptr)
+	{
+		pContext->ReportError("Could not convert view to JSON");
+		return BAD_HANDLE;
+	}
+
+	HandleError err;
+	HandleSecurity sec(pContext->GetIdentity(), myself->GetIdentity());
+	Handle_t hndlObject = handlesys->CreateHandleEx(htJSON, object, &sec, nullptr, &err);
+	if (hndlObject == BAD_HANDLE)
+	{
+		json_decref(object);
+
+		pContext->ReportError("Could not create object handle (error %d)", err);
+		return BAD_HANDLE;
+	}
+
+	return hndlObject;
+}
+
 const sp_nativeinfo_t json_natives[] =
 	{
 		// Objects
@@ -994,6 +2194,7 @@ const sp_nativeinfo_t json_natives[] =
 		{"JSONObject.GetString", 			GetObjectStringValue},
 		{"JSONObject.IsNull", 				IsObjectNullValue},
 		{"JSONObject.HasKey", 				IsObjectKeyValid},
+		{"JSONObject.GetType", 				GetObjectValueType},
 		{"JSONObject.Set", 					SetObjectValue},
 		{"JSONObject.SetBool", 				SetObjectBoolValue},
 		{"JSONObject.SetFloat", 			SetObjectFloatValue},
@@ -1033,6 +2234,20 @@ const sp_nativeinfo_t json_natives[] =
 		{"JSONArray.PushString", 			PushArrayStringValue},
 		{"JSONArray.Remove", 				RemoveFromArray},
 		{"JSONArray.Clear", 				ClearArray},
+		{"JSONArray.GetInts", 				GetArrayInts},
+		{"JSONArray.GetFloats", 			GetArrayFloats},
+		{"JSONArray.GetBools", 				GetArrayBools},
+		{"JSONArray.GetStrings", 			GetArrayStrings},
+		{"JSONArray.PushInts", 				PushArrayInts},
+		{"JSONArray.PushFloats", 			PushArrayFloats},
+		{"JSONArray.PushBools", 			PushArrayBools},
+		{"JSONArray.SetInts", 				SetArrayInts},
+		{"JSONArray.SetFloats", 			SetArrayFloats},
+		{"JSONArray.SetBools", 				SetArrayBools},
+
+		// ArrayList conversion
+		{"JSONArray.ToArrayList", 			ArrayToArrayList},
+		{"JSONArray.FromArrayList", 		ArrayFromArrayList},
 
 		// Decoding
 		{"JSONObject.FromString", 			FromString},
@@ -1043,5 +2258,49 @@ const sp_nativeinfo_t json_natives[] =
 		// Encoding
 		{"JSON.ToString", 					ToString},
 		{"JSON.ToFile", 					ToFile},
+		{"JSON.LoadFileAsync", 				LoadFileAsync},
+		{"JSON.SaveFileAsync", 				SaveFileAsync},
+
+		// Paths
+		{"JSON.GetByPath", 					GetValueAtPath},
+		{"JSON.GetBoolByPath", 				GetBoolAtPath},
+		{"JSON.GetFloatByPath", 			GetFloatAtPath},
+		{"JSON.GetIntByPath", 				GetIntAtPath},
+		{"JSON.GetInt64ByPath", 			GetInt64AtPath},
+		{"JSON.GetStringByPath", 			GetStringAtPath},
+		{"JSON.IsNullByPath", 				IsNullAtPath},
+		{"JSON.HasPath", 					HasPath},
+		{"JSON.SetByPath", 					SetValueAtPath},
+		{"JSON.SetBoolByPath", 				SetBoolAtPath},
+		{"JSON.SetFloatByPath", 			SetFloatAtPath},
+		{"JSON.SetIntByPath", 				SetIntAtPath},
+		{"JSON.SetInt64ByPath", 			SetInt64AtPath},
+		{"JSON.SetStringByPath", 			SetStringAtPath},
+		{"JSON.SetNullByPath", 				SetNullAtPath},
+		{"JSON.RemoveByPath", 				RemoveAtPath},
+
+		// Format strings
+		{"JSON.Unpack", 					Unpack},
+		{"JSON.Pack", 						Pack},
+
+		// Diff and patch
+		{"JSON.Diff", 						Diff},
+		{"JSON.MergeDiff", 					MergeDiff},
+		{"JSON.ApplyPatch", 				ApplyPatch},
+		{"JSON.ApplyMergePatch", 			ApplyMergePatch},
+
+		// Read-only views
+		{"JSONView.FromString", 			ViewFromString},
+		{"JSONView.Get", 					GetViewValue},
+		{"JSONView.GetBool", 				GetViewBool},
+		{"JSONView.GetFloat", 				GetViewFloat},
+		{"JSONView.GetInt", 				GetViewInt},
+		{"JSONView.GetInt64", 				GetViewInt64},
+		{"JSONView.GetString", 				GetViewString},
+		{"JSONView.IsNull", 				IsViewNull},
+		{"JSONView.HasPath", 				HasViewPath},
+		{"JSONView.GetType", 				GetViewType},
+		{"JSONView.GetSize", 				GetViewSize},
+		{"JSONView.ToJSON", 				ViewToJSON},
 
 		{nullptr, nullptr}};
@@ -0,0 +1,541 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json_pack.h"
+
+JSONFormatWalker::JSONFormatWalker(IPluginContext *pContext, const cell_t *params, unsigned int first)
+	: pContext(pContext), params(params), arg(first), fmt(""), formatError(false)
+{
+}
+
+bool JSONFormatWalker::HasFormatError() const
+{
+	return this->formatError;
+}
+
+const std::string &JSONFormatWalker::GetError() const
+{
+	return this->error;
+}
+
+char JSONFormatWalker::Peek()
+{
+	while (*this->fmt == ' ' || *this->fmt == '\t' || *this->fmt == '\n' || *this->fmt == ',' || *this->fmt == ':')
+	{
+		this->fmt++;
+	}
+	return *this->fmt;
+}
+
+bool JSONFormatWalker::Expect(char c)
+{
+	if (this->Peek() != c)
+	{
+		return false;
+	}
+	this->fmt++;
+	return true;
+}
+
+bool JSONFormatWalker::NextCell(cell_t **addr)
+{
+	// Variadic arguments are always passed by reference.
+	if (this->arg > static_cast<unsigned int>(this->params[0]))
+	{
+		return this->FormatError("not enough arguments for format");
+	}
+	this->pContext->LocalToPhysAddr(this->params[this->arg++], addr);
+	return true;
+}
+
+bool JSONFormatWalker::NextString(char **str)
+{
+	if (this->arg > static_cast<unsigned int>(this->params[0]))
+	{
+		return this->FormatError("not enough arguments for format");
+	}
+	this->pContext->LocalToString(this->params[this->arg++], str);
+	return true;
+}
+
+bool JSONFormatWalker::FormatError(const char *msg)
+{
+	if (this->error.empty())
+	{
+		this->formatError = true;
+		this->error = msg;
+	}
+	return false;
+}
+
+bool JSONFormatWalker::DataError(const std::string &msg)
+{
+	if (this->error.empty())
+	{
+		this->error = msg;
+	}
+	return false;
+}
+
+static const char *TypeName(json_t *value)
+{
+	switch (json_typeof(value))
+	{
+	case JSON_OBJECT:	return "object";
+	case JSON_ARRAY:	return "array";
+	case JSON_STRING:	return "string";
+	case JSON_INTEGER:	return "integer";
+	case JSON_REAL:		return "real";
+	case JSON_TRUE:		return "true";
+	case JSON_FALSE:	return "false";
+	case JSON_NULL:		return "null";
+	}
+	return "unknown";
+}
+
+bool JSONUnpacker::Unpack(json_t *root, const char *format)
+{
+	this->fmt = format;
+	bool matched = this->Value(root);
+	if (matched && this->Peek() != '\0')
+	{
+		matched = this->FormatError("garbage after format string");
+	}
+	if (matched)
+	{
+		return true;
+	}
+
+	// Callers only check the return value, so no handle may outlive a failed unpack.
+	HandleSecurity sec(this->pContext->GetIdentity(), myself->GetIdentity());
+	for (const auto &created : this->handles)
+	{
+		handlesys->FreeHandle(created.second, &sec);
+		*created.first = BAD_HANDLE;
+	}
+	this->handles.clear();
+	return false;
+}
+
+bool JSONUnpacker::Value(json_t *value)
+{
+	char c = this->Peek();
+	if (c == '\0')
+	{
+		return this->FormatError("unexpected end of format string");
+	}
+	this->fmt++;
+
+	auto expected = [this, value](const char *type) {
+		return this->DataError(std::string("expected ") + type + ", got " + TypeName(value));
+	};
+
+	switch (c)
+	{
+	case '{':
+		if (value != nullptr && !json_is_object(value))
+		{
+			return expected("object");
+		}
+		return this->Object(value);
+
+	case '[':
+		if (value != nullptr && !json_is_array(value))
+		{
+			return expected("array");
+		}
+		return this->Array(value);
+
+	case 's':
+	case 'I':
+	{
+		char *buffer;
+		cell_t *maxlength;
+		if (!this->NextString(&buffer) || !this->NextCell(&maxlength))
+		{
+			return false;
+		}
+		if (value == nullptr)
+		{
+			return true;
+		}
+
+		char result[20];
+		const char *str;
+		if (c == 's')
+		{
+			if (!json_is_string(value))
+			{
+				return expected("string");
+			}
+			str = json_string_value(value);
+		}
+		else
+		{
+			if (!json_is_integer(value))
+			{
+				return expected("integer");
+			}
+			snprintf(result, sizeof(result), "%" JSON_INTEGER_FORMAT, json_integer_value(value));
+			str = result;
+		}
+
+		this->pContext->StringToLocalUTF8(this->params[this->arg - 2], *maxlength, str, nullptr);
+		return true;
+	}
+
+	case 'i':
+	case 'b':
+	case 'f':
+	case 'F':
+	case 'o':
+	case 'O':
+	{
+		cell_t *addr;
+		if (!this->NextCell(&addr))
+		{
+			return false;
+		}
+		if (value == nullptr)
+		{
+			return true;
+		}
+
+		if (c == 'i')
+		{
+			if (!json_is_integer(value))
+			{
+				return expected("integer");
+			}
+			*addr = static_cast<cell_t>(json_integer_value(value));
+		}
+		else if (c == 'b')
+		{
+			if (!json_is_boolean(value))
+			{
+				return expected("true or false");
+			}
+			*addr = json_is_true(value);
+		}
+		else if (c == 'f' || c == 'F')
+		{
+			if (c == 'f' ? !json_is_real(value) : !json_is_number(value))
+			{
+				return expected(c == 'f' ? "real" : "real or integer");
+			}
+			*addr = sp_ftoc(static_cast<float>(json_number_value(value)));
+		}
+		else
+		{
+			HandleError err;
+			HandleSecurity sec(this->pContext->GetIdentity(), myself->GetIdentity());
+			Handle_t hndl = handlesys->CreateHandleEx(htJSON, value, &sec, nullptr, &err);
+			if (hndl == BAD_HANDLE)
+			{
+				return this->FormatError("could not create value handle");
+			}
+			json_incref(value);
+			*addr = hndl;
+			this->handles.emplace_back(addr, hndl);
+		}
+		return true;
+	}
+
+	case 'n':
+		if (value != nullptr && !json_is_null(value))
+		{
+			return expected("null");
+		}
+		return true;
+	}
+
+	return this->FormatError("unexpected format character");
+}
+
+bool JSONUnpacker::Strict(size_t unpacked, size_t size, bool skip)
+{
+	char c = this->Peek();
+	if (c != '!' && c != '*')
+	{
+		return true;
+	}
+	this->fmt++;
+
+	if (c == '!' && !skip && unpacked != size)
+	{
+		return this->DataError(std::to_string(size - unpacked) + " item(s) left unpacked");
+	}
+	return true;
+}
+
+bool JSONUnpacker::Object(json_t *object)
+{
+	size_t unpacked = 0;
+	for (;;)
+	{
+		char c = this->Peek();
+		if (c == '!' || c == '*')
+		{
+			if (!this->Strict(unpacked, object ? json_object_size(object) : 0, object == nullptr))
+			{
+				return false;
+			}
+			c = this->Peek();
+		}
+
+		if (c == '}')
+		{
+			this->fmt++;
+			return true;
+		}
+
+		if (c != 's')
+		{
+			return this->FormatError("expected 's' for object key or '}'");
+		}
+		this->fmt++;
+
+		bool optional = (*this->fmt == '?');
+		if (optional)
+		{
+			this->fmt++;
+		}
+
+		char *key;
+		if (!this->NextString(&key))
+		{
+			return false;
+		}
+
+		json_t *value = object ? json_object_get(object, key) : nullptr;
+		if (object != nullptr && value == nullptr && !optional)
+		{
+			return this->DataError(std::string("object item not found: ") + key);
+		}
+		if (value != nullptr)
+		{
+			unpacked++;
+		}
+
+		if (!this->Value(value))
+		{
+			return false;
+		}
+	}
+}
+
+bool JSONUnpacker::Array(json_t *array)
+{
+	size_t index = 0;
+	for (;;)
+	{
+		char c = this->Peek();
+		if (c == '!' || c == '*')
+		{
+			if (!this->Strict(index, array ? json_array_size(array) : 0, array == nullptr))
+			{
+				return false;
+			}
+			c = this->Peek();
+		}
+
+		if (c == ']')
+		{
+			this->fmt++;
+			return true;
+		}
+
+		json_t *value = nullptr;
+		if (array != nullptr)
+		{
+			value = json_array_get(array, index);
+			if (value == nullptr)
+			{
+				return this->DataError("array index " + std::to_string(index) + " out of range");
+			}
+		}
+		index++;
+
+		if (!this->Value(value))
+		{
+			return false;
+		}
+	}
+}
+
+json_t *JSONPacker::Pack(const char *format)
+{
+	this->fmt = format;
+	json_t *result = this->Value();
+	if (result != nullptr && this->Peek() != '\0')
+	{
+		json_decref(result);
+		this->FormatError("garbage after format string");
+		return nullptr;
+	}
+	return result;
+}
+
+json_t *JSONPacker::Value()
+{
+	char c = this->Peek();
+	if (c == '\0')
+	{
+		this->FormatError("unexpected end of format string");
+		return nullptr;
+	}
+	this->fmt++;
+
+	switch (c)
+	{
+	case '{':
+		return this->Object();
+
+	case '[':
+		return this->Array();
+
+	case 's':
+	case 'I':
+	{
+		char *str;
+		if (!this->NextString(&str))
+		{
+			return nullptr;
+		}
+
+		if (c == 'I')
+		{
+			return json_integer(strtoll(str, nullptr, 10));
+		}
+
+		json_t *value = json_string(str);
+		if (value == nullptr)
+		{
+			this->DataError("invalid UTF-8 string");
+		}
+		return value;
+	}
+
+	case 'i':
+	case 'b':
+	case 'f':
+	case 'F':
+	case 'o':
+	case 'O':
+	{
+		cell_t *addr;
+		if (!this->NextCell(&addr))
+		{
+			return nullptr;
+		}
+
+		if (c == 'i')
+		{
+			return json_integer(*addr);
+		}
+		if (c == 'b')
+		{
+			return json_boolean(*addr);
+		}
+		if (c == 'f' || c == 'F')
+		{
+			return json_real(sp_ctof(*addr));
+		}
+
+		// The plugin keeps its handle either way, the packed value holds its own reference.
+		json_t *value;
+		HandleSecurity sec(this->pContext->GetIdentity(), myself->GetIdentity());
+		if (handlesys->ReadHandle(static_cast<Handle_t>(*addr), htJSON, &sec, (void **)&value) != HandleError_None)
+		{
+			this->FormatError("invalid JSON handle");
+			return nullptr;
+		}
+		return json_incref(value);
+	}
+
+	case 'n':
+		return json_null();
+	}
+
+	this->FormatError("unexpected format character");
+	return nullptr;
+}
+
+json_t *JSONPacker::Object()
+{
+	json_t *object = json_object();
+	for (;;)
+	{
+		char c = this->Peek();
+		if (c == '}')
+		{
+			this->fmt++;
+			return object;
+		}
+
+		if (c != 's')
+		{
+			this->FormatError("expected 's' for object key or '}'");
+			break;
+		}
+		this->fmt++;
+
+		char *key;
+		if (!this->NextString(&key))
+		{
+			break;
+		}
+
+		json_t *value = this->Value();
+		if (value == nullptr || json_object_set_new(object, key, value) != 0)
+		{
+			this->DataError(std::string("could not set object item: ") + key);
+			break;
+		}
+	}
+
+	json_decref(object);
+	return nullptr;
+}
+
+json_t *JSONPacker::Array()
+{
+	json_t *array = json_array();
+	for (;;)
+	{
+		char c = this->Peek();
+		if (c == ']')
+		{
+			this->fmt++;
+			return array;
+		}
+
+		json_t *value = this->Value();
+		if (value == nullptr || json_array_append_new(array, value) != 0)
+		{
+			this->DataError("could not append array item");
+			break;
+		}
+	}
+
+	json_decref(array);
+	return nullptr;
+}
@@ -0,0 +1,101 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SM_RIPEXT_JSONPACK_H_
+#define SM_RIPEXT_JSONPACK_H_
+
+#include "extension.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Interprets jansson's pack/unpack format strings against plugin arguments.
+// json_pack_ex and json_unpack_ex only take C varargs, which cannot be built from
+// a native's parameter list, so the grammar is walked here instead:
+//
+//   s  string      (unpack: char[] buffer, int maxlength)
+//   i  int         b  bool         f  float (unpack: real only)   F  any number
+//   I  int64 as a decimal string (unpack: char[] buffer, int maxlength)
+//   n  null, takes no argument
+//   o/O JSON handle (unpack creates a new handle that must be freed, unless unpacking fails)
+//   {s:v ...}      object, keys are taken from the arguments, s? marks an optional key
+//   [v ...]        array
+//   ! at the end of an object or array requires every item to be unpacked, * allows extras
+//
+// Whitespace, ':' and ',' are ignored.
+class JSONFormatWalker
+{
+public:
+	JSONFormatWalker(IPluginContext *pContext, const cell_t *params, unsigned int first);
+
+	// Format and argument mistakes are reported as plugin errors, data mismatches are not.
+	bool HasFormatError() const;
+	const std::string &GetError() const;
+
+protected:
+	char Peek();
+	bool Expect(char c);
+	bool NextCell(cell_t **addr);
+	bool NextString(char **str);
+	bool FormatError(const char *msg);
+	bool DataError(const std::string &msg);
+
+	IPluginContext *pContext;
+	const cell_t *params;
+	unsigned int arg;
+	const char *fmt;
+	bool formatError;
+	std::string error;
+};
+
+class JSONUnpacker : public JSONFormatWalker
+{
+public:
+	using JSONFormatWalker::JSONFormatWalker;
+
+	bool Unpack(json_t *root, const char *format);
+
+private:
+	// A null value walks the format and consumes arguments without storing anything.
+	bool Value(json_t *value);
+	bool Object(json_t *object);
+	bool Array(json_t *array);
+	bool Strict(size_t unpacked, size_t size, bool skip);
+
+	// Handles stored so far, freed again if a later item fails to match.
+	std::vector<std::pair<cell_t *, Handle_t>> handles;
+};
+
+class JSONPacker : public JSONFormatWalker
+{
+public:
+	using JSONFormatWalker::JSONFormatWalker;
+
+	// Returns a new reference, or nullptr on error.
+	json_t *Pack(const char *format);
+
+private:
+	json_t *Value();
+	json_t *Object();
+	json_t *Array();
+};
+
+#endif // SM_RIPEXT_JSONPACK_H_
@@ -0,0 +1,636 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json_patch.h"
+#include "json_path.h"
+#include <algorithm>
+
+json_t *JSONPatch::Diff(json_t *from, json_t *to)
+{
+	json_t *patch = json_array();
+	if (patch == nullptr)
+	{
+		return nullptr;
+	}
+
+	std::string pointer;
+	if (!DiffValue(patch, pointer, from, to))
+	{
+		json_decref(patch);
+		return nullptr;
+	}
+
+	return patch;
+}
+
+bool JSONPatch::DiffValue(json_t *patch, std::string &pointer, json_t *from, json_t *to)
+{
+	size_t length = pointer.size();
+
+	if (json_is_object(from) && json_is_object(to))
+	{
+		for (void *iter = json_object_iter(from); iter != nullptr; iter = json_object_iter_next(from, iter))
+		{
+			const char *key = json_object_iter_key(iter);
+			size_t keyLength = json_object_iter_key_len(iter);
+			json_t *value = json_object_getn(to, key, keyLength);
+
+			AppendToken(pointer, key, keyLength);
+			bool ok = (value == nullptr)
+				? AddOperation(patch, "remove", pointer, nullptr)
+				: DiffValue(patch, pointer, json_object_iter_value(iter), value);
+			pointer.resize(length);
+
+			if (!ok)
+			{
+				return false;
+			}
+		}
+
+		for (void *iter = json_object_iter(to); iter != nullptr; iter = json_object_iter_next(to, iter))
+		{
+			const char *key = json_object_iter_key(iter);
+			size_t keyLength = json_object_iter_key_len(iter);
+			if (json_object_getn(from, key, keyLength) != nullptr)
+			{
+				continue;
+			}
+
+			AppendToken(pointer, key, keyLength);
+			bool ok = AddOperation(patch, "add", pointer, json_object_iter_value(iter));
+			pointer.resize(length);
+
+			if (!ok)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	if (json_is_array(from) && json_is_array(to))
+	{
+		size_t fromSize = json_array_size(from);
+		size_t toSize = json_array_size(to);
+		size_t common = std::min(fromSize, toSize);
+		char index[24];
+
+		for (size_t i = 0; i < common; i++)
+		{
+			snprintf(index, sizeof(index), "/%u", (unsigned int)i);
+			pointer.append(index);
+			bool ok = DiffValue(patch, pointer, json_array_get(from, i), json_array_get(to, i));
+			pointer.resize(length);
+
+			if (!ok)
+			{
+				return false;
+			}
+		}
+
+		// Remove from the end so the remaining indices stay valid
+		for (size_t i = fromSize; i > common; i--)
+		{
+			snprintf(index, sizeof(index), "/%u", (unsigned int)(i - 1));
+			pointer.append(index);
+			bool ok = AddOperation(patch, "remove", pointer, nullptr);
+			pointer.resize(length);
+
+			if (!ok)
+			{
+				return false;
+			}
+		}
+
+		for (size_t i = common; i < toSize; i++)
+		{
+			pointer.append("/-");
+			bool ok = AddOperation(patch, "add", pointer, json_array_get(to, i));
+			pointer.resize(length);
+
+			if (!ok)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	if (json_equal(from, to))
+	{
+		return true;
+	}
+
+	return AddOperation(patch, "replace", pointer, to);
+}
+
+bool JSONPatch::AddOperation(json_t *patch, const char *op, const std::string &pointer, json_t *value)
+{
+	// The patch gets its own copy of the value, so later changes to the document don't leak into it
+	json_t *operation = (value != nullptr)
+		? json_pack("{s:s, s:s%, s:o}", "op", op, "path", pointer.c_str(), pointer.size(), "value", json_deep_copy(value))
+		: json_pack("{s:s, s:s%}", "op", op, "path", pointer.c_str(), pointer.size());
+
+	return operation != nullptr && json_array_append_new(patch, operation) == 0;
+}
+
+void JSONPatch::AppendToken(std::string &pointer, const char *key, size_t length)
+{
+	pointer.push_back('/');
+	for (size_t i = 0; i < length; i++)
+	{
+		if (key[i] == '~')
+		{
+			pointer.append("~0");
+		}
+		else if (key[i] == '/')
+		{
+			pointer.append("~1");
+		}
+		else
+		{
+			pointer.push_back(key[i]);
+		}
+	}
+}
+
+json_t *JSONPatch::MergeDiff(json_t *from, json_t *to)
+{
+	if (!json_is_object(from) || !json_is_object(to))
+	{
+		return json_deep_copy(to);
+	}
+
+	json_t *patch = json_object();
+	if (patch == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (void *iter = json_object_iter(from); iter != nullptr; iter = json_object_iter_next(from, iter))
+	{
+		const char *key = json_object_iter_key(iter);
+		size_t keyLength = json_object_iter_key_len(iter);
+		if (json_object_getn(to, key, keyLength) == nullptr && json_object_setn_new_nocheck(patch, key, keyLength, json_null()) != 0)
+		{
+			json_decref(patch);
+			return nullptr;
+		}
+	}
+
+	for (void *iter = json_object_iter(to); iter != nullptr; iter = json_object_iter_next(to, iter))
+	{
+		const char *key = json_object_iter_key(iter);
+		size_t keyLength = json_object_iter_key_len(iter);
+		json_t *value = json_object_iter_value(iter);
+		json_t *previous = json_object_getn(from, key, keyLength);
+
+		json_t *change;
+		if (previous == nullptr)
+		{
+			change = json_deep_copy(value);
+		}
+		else if (json_is_object(previous) && json_is_object(value))
+		{
+			change = MergeDiff(previous, value);
+			if (change != nullptr && json_object_size(change) == 0)
+			{
+				json_decref(change);
+				continue;
+			}
+		}
+		else if (!json_equal(previous, value))
+		{
+			change = json_deep_copy(value);
+		}
+		else
+		{
+			continue;
+		}
+
+		if (json_object_setn_new_nocheck(patch, key, keyLength, change) != 0)
+		{
+			json_decref(patch);
+			return nullptr;
+		}
+	}
+
+	return patch;
+}
+
+bool JSONPatch::Apply(json_t *root, json_t *patch, std::string &error)
+{
+	if (!json_is_array(patch))
+	{
+		error = "patch must be an array of operations";
+		return false;
+	}
+
+	// RFC 6902 section 5: a patch is applied completely or not at all. Only objects and
+	// arrays can be changed in place, operations on anything else fail on their own.
+	json_t *target = root;
+	if (json_is_object(root) || json_is_array(root))
+	{
+		target = json_deep_copy(root);
+		if (target == nullptr)
+		{
+			error = "out of memory";
+			return false;
+		}
+	}
+
+	size_t index;
+	json_t *operation;
+	json_array_foreach(patch, index, operation)
+	{
+		if (!ApplyOperation(target, operation, error))
+		{
+			error = "operation " + std::to_string(index) + ": " + error;
+			if (target != root)
+			{
+				json_decref(target);
+			}
+			return false;
+		}
+	}
+
+	if (target == root)
+	{
+		return true;
+	}
+
+	bool ok = ReplaceRoot(root, target, error);
+	json_decref(target);
+	return ok;
+}
+
+bool JSONPatch::ApplyOperation(json_t *root, json_t *operation, std::string &error)
+{
+	const char *op = json_string_value(json_object_get(operation, "op"));
+	if (op == nullptr)
+	{
+		error = "missing \"op\"";
+		return false;
+	}
+
+	std::shared_ptr<const JSONPath> path = GetPointer(operation, "path", error);
+	if (path == nullptr)
+	{
+		return false;
+	}
+
+	if (strcmp(op, "remove") == 0)
+	{
+		json_t *removed = RemoveValue(root, path.get(), error);
+		json_decref(removed);
+		return removed != nullptr;
+	}
+
+	if (strcmp(op, "move") == 0 || strcmp(op, "copy") == 0)
+	{
+		const char *fromPointer = json_string_value(json_object_get(operation, "from"));
+		std::shared_ptr<const JSONPath> from = GetPointer(operation, "from", error);
+		if (from == nullptr)
+		{
+			return false;
+		}
+
+		json_t *value = from->Get(root);
+		if (value == nullptr)
+		{
+			error = std::string("no value at \"") + fromPointer + "\"";
+			return false;
+		}
+
+		if (op[0] == 'c')
+		{
+			return AddValue(root, path.get(), json_deep_copy(value), error);
+		}
+
+		// A value can't be moved into one of its own children
+		const char *toPointer = json_string_value(json_object_get(operation, "path"));
+		size_t fromLength = strlen(fromPointer);
+		if (strcmp(fromPointer, toPointer) == 0)
+		{
+			return true;
+		}
+		if (strncmp(fromPointer, toPointer, fromLength) == 0 && toPointer[fromLength] == '/')
+		{
+			error = "cannot move a value into itself";
+			return false;
+		}
+
+		value = RemoveValue(root, from.get(), error);
+		return value != nullptr && AddValue(root, path.get(), value, error);
+	}
+
+	json_t *value = json_object_get(operation, "value");
+	if (value == nullptr)
+	{
+		error = "missing \"value\"";
+		return false;
+	}
+
+	if (strcmp(op, "add") == 0)
+	{
+		return AddValue(root, path.get(), json_deep_copy(value), error);
+	}
+
+	if (strcmp(op, "replace") == 0)
+	{
+		return ReplaceValue(root, path.get(), json_deep_copy(value), error);
+	}
+
+	if (strcmp(op, "test") == 0)
+	{
+		if (!ValuesEqual(path->Get(root), value))
+		{
+			error = "test failed";
+			return false;
+		}
+		return true;
+	}
+
+	error = std::string("unknown operation \"") + op + "\"";
+	return false;
+}
+
+std::shared_ptr<const JSONPath> JSONPatch::GetPointer(json_t *operation, const char *member, std::string &error)
+{
+	const char *pointer = json_string_value(json_object_get(operation, member));
+	if (pointer == nullptr)
+	{
+		error = std::string("missing \"") + member + "\"";
+		return nullptr;
+	}
+
+	// Only JSON Pointers, not the dotted paths JSONPath also accepts
+	if (pointer[0] != '\0' && pointer[0] != '/')
+	{
+		error = std::string("\"") + pointer + "\" is not a JSON pointer";
+		return nullptr;
+	}
+
+	return JSONPath::Compile(pointer, error);
+}
+
+bool JSONPatch::AddValue(json_t *root, const JSONPath *path, json_t *value, std::string &error)
+{
+	// Takes the reference to value
+	if (value == nullptr)
+	{
+		error = "out of memory";
+		return false;
+	}
+
+	if (path->GetSegments().empty())
+	{
+		bool ok = ReplaceRoot(root, value, error);
+		json_decref(value);
+		return ok;
+	}
+
+	json_t *parent = path->Parent(root, false);
+	const JSONPath::Segment &last = path->GetSegments().back();
+	if (json_is_object(parent))
+	{
+		return json_object_setn_new(parent, last.key.c_str(), last.key.size(), value) == 0;
+	}
+
+	if (json_is_array(parent))
+	{
+		if (last.append)
+		{
+			return json_array_append_new(parent, value) == 0;
+		}
+		if (last.numeric && last.index <= json_array_size(parent))
+		{
+			return json_array_insert_new(parent, last.index, value) == 0;
+		}
+	}
+
+	json_decref(value);
+	error = "invalid path";
+	return false;
+}
+
+bool JSONPatch::ReplaceValue(json_t *root, const JSONPath *path, json_t *value, std::string &error)
+{
+	// Takes the reference to value
+	if (value == nullptr)
+	{
+		error = "out of memory";
+		return false;
+	}
+
+	if (path->GetSegments().empty())
+	{
+		bool ok = ReplaceRoot(root, value, error);
+		json_decref(value);
+		return ok;
+	}
+
+	json_t *parent = path->Parent(root, false);
+	const JSONPath::Segment &last = path->GetSegments().back();
+	if (json_is_object(parent) && json_object_getn(parent, last.key.c_str(), last.key.size()) != nullptr)
+	{
+		return json_object_setn_new(parent, last.key.c_str(), last.key.size(), value) == 0;
+	}
+
+	if (json_is_array(parent) && last.numeric && last.index < json_array_size(parent))
+	{
+		return json_array_set_new(parent, last.index, value) == 0;
+	}
+
+	json_decref(value);
+	error = "no value at path";
+	return false;
+}
+
+json_t *JSONPatch::RemoveValue(json_t *root, const JSONPath *path, std::string &error)
+{
+	// Returns the removed value, the caller owns the reference
+	if (path->GetSegments().empty())
+	{
+		error = "cannot remove the whole document";
+		return nullptr;
+	}
+
+	json_t *value = json_incref(path->Get(root));
+	if (value == nullptr || !path->Remove(root))
+	{
+		json_decref(value);
+		error = "no value at path";
+		return nullptr;
+	}
+
+	return value;
+}
+
+bool JSONPatch::ReplaceRoot(json_t *root, json_t *value, std::string &error)
+{
+	// Handles keep pointing at root, so it is refilled rather than swapped
+	if (root == value)
+	{
+		return true;
+	}
+
+	if (json_is_object(root) && json_is_object(value))
+	{
+		json_object_clear(root);
+		return json_object_update(root, value) == 0;
+	}
+
+	if (json_is_array(root) && json_is_array(value))
+	{
+		json_array_clear(root);
+		return json_array_extend(root, value) == 0;
+	}
+
+	error = "the whole document can only be replaced by a value of the same type";
+	return false;
+}
+
+// json_equal, except that numbers are equal when their values are (RFC 6902 section 4.6)
+bool JSONPatch::ValuesEqual(json_t *value1, json_t *value2)
+{
+	if (value1 == nullptr || value2 == nullptr)
+	{
+		return false;
+	}
+
+	if (json_is_number(value1) && json_is_number(value2))
+	{
+		if (json_is_integer(value1) && json_is_integer(value2))
+		{
+			return json_integer_value(value1) == json_integer_value(value2);
+		}
+		return json_number_value(value1) == json_number_value(value2);
+	}
+
+	if (json_is_array(value1) && json_is_array(value2))
+	{
+		size_t size = json_array_size(value1);
+		if (size != json_array_size(value2))
+		{
+			return false;
+		}
+		for (size_t i = 0; i < size; i++)
+		{
+			if (!ValuesEqual(json_array_get(value1, i), json_array_get(value2, i)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (json_is_object(value1) && json_is_object(value2))
+	{
+		if (json_object_size(value1) != json_object_size(value2))
+		{
+			return false;
+		}
+		const char *key;
+		size_t keyLength;
+		json_t *value;
+		json_object_keylen_foreach(value1, key, keyLength, value)
+		{
+			if (!ValuesEqual(value, json_object_getn(value2, key, keyLength)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	return json_equal(value1, value2);
+}
+
+bool JSONPatch::ApplyMerge(json_t *root, json_t *patch, std::string &error)
+{
+	if (!json_is_object(patch))
+	{
+		json_t *copy = json_deep_copy(patch);
+		bool ok = ReplaceRoot(root, copy, error);
+		json_decref(copy);
+		return ok;
+	}
+
+	if (!json_is_object(root))
+	{
+		error = "an object patch can only be merged into an object";
+		return false;
+	}
+
+	if (!MergeObject(root, patch))
+	{
+		error = "out of memory";
+		return false;
+	}
+
+	return true;
+}
+
+bool JSONPatch::MergeObject(json_t *target, json_t *patch)
+{
+	for (void *iter = json_object_iter(patch); iter != nullptr; iter = json_object_iter_next(patch, iter))
+	{
+		const char *key = json_object_iter_key(iter);
+		size_t keyLength = json_object_iter_key_len(iter);
+		json_t *value = json_object_iter_value(iter);
+
+		if (json_is_null(value))
+		{
+			json_object_deln(target, key, keyLength);
+			continue;
+		}
+
+		if (!json_is_object(value))
+		{
+			if (json_object_setn_new(target, key, keyLength, json_deep_copy(value)) != 0)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		// Nested patches are merged into an object, replacing whatever else was there
+		json_t *child = json_object_getn(target, key, keyLength);
+		if (!json_is_object(child))
+		{
+			child = json_object();
+			if (json_object_setn_new(target, key, keyLength, child) != 0)
+			{
+				return false;
+			}
+		}
+
+		if (!MergeObject(child, value))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
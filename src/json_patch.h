@@ -0,0 +1,67 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SM_RIPEXT_JSONPATCH_H_
+#define SM_RIPEXT_JSONPATCH_H_
+
+#include "extension.h"
+#include <memory>
+#include <string>
+
+class JSONPath;
+
+// Deltas between two documents, as a JSON Patch (RFC 6902) or a JSON Merge Patch (RFC 7386).
+//
+// Diff only emits add, remove and replace. Arrays are compared index by index, so an
+// element inserted near the front replaces every element after it.
+//
+// A merge patch cannot set a member to null, null means removal. Diffs between
+// documents with null members should use a JSON Patch instead.
+class JSONPatch
+{
+public:
+	// Both return a new reference, or nullptr if out of memory.
+	static json_t *Diff(json_t *from, json_t *to);
+	static json_t *MergeDiff(json_t *from, json_t *to);
+
+	// Patches root in place. Operations are applied in order to a copy of root, which
+	// replaces root only if all of them succeed, so a failing patch changes nothing.
+	// The index of the failing operation is given in the error.
+	// The whole document can only be replaced by a value of the same type.
+	static bool Apply(json_t *root, json_t *patch, std::string &error);
+	static bool ApplyMerge(json_t *root, json_t *patch, std::string &error);
+
+private:
+	static bool DiffValue(json_t *patch, std::string &pointer, json_t *from, json_t *to);
+	static bool AddOperation(json_t *patch, const char *op, const std::string &pointer, json_t *value);
+	static void AppendToken(std::string &pointer, const char *key, size_t length);
+
+	static bool ApplyOperation(json_t *root, json_t *operation, std::string &error);
+	static std::shared_ptr<const JSONPath> GetPointer(json_t *operation, const char *member, std::string &error);
+	static bool AddValue(json_t *root, const JSONPath *path, json_t *value, std::string &error);
+	static bool ReplaceValue(json_t *root, const JSONPath *path, json_t *value, std::string &error);
+	static json_t *RemoveValue(json_t *root, const JSONPath *path, std::string &error);
+	static bool ReplaceRoot(json_t *root, json_t *value, std::string &error);
+	static bool ValuesEqual(json_t *value1, json_t *value2);
+	static bool MergeObject(json_t *target, json_t *patch);
+};
+
+#endif // SM_RIPEXT_JSONPATCH_H_
@@ -0,0 +1,286 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json_path.h"
+#include <unordered_map>
+
+// Only touched from natives, which run on the game thread.
+static std::unordered_map<std::string, std::shared_ptr<const JSONPath>> g_PathCache;
+
+std::shared_ptr<const JSONPath> JSONPath::Compile(const char *path, std::string &error)
+{
+	auto it = g_PathCache.find(path);
+	if (it != g_PathCache.end())
+	{
+		return it->second;
+	}
+
+	auto compiled = std::make_shared<JSONPath>();
+	bool ok = (path[0] == '/' || path[0] == '\0') ? compiled->ParsePointer(path, error) : compiled->ParseDotted(path, error);
+	if (!ok)
+	{
+		return nullptr;
+	}
+
+	if (g_PathCache.size() >= SM_RIPEXT_JSONPATH_CACHE_SIZE)
+	{
+		g_PathCache.clear();
+	}
+
+	g_PathCache.emplace(path, compiled);
+	return compiled;
+}
+
+void JSONPath::AddSegment(std::vector<Segment> &segments, std::string key, bool bracketed)
+{
+	Segment segment;
+	segment.index = 0;
+	segment.bracketed = bracketed;
+	segment.append = (key == "-");
+
+	// Array indices have no sign and no leading zeros, as in RFC 6901.
+	segment.numeric = !key.empty() && key.size() <= 9 && (key[0] != '0' || key.size() == 1);
+	for (char c : key)
+	{
+		if (c < '0' || c > '9')
+		{
+			segment.numeric = false;
+			break;
+		}
+	}
+	if (segment.numeric)
+	{
+		segment.index = std::stoul(key);
+	}
+
+	segment.key = std::move(key);
+	segments.push_back(std::move(segment));
+}
+
+bool JSONPath::ParsePointer(const char *path, std::string &error)
+{
+	// The empty pointer refers to the whole document.
+	const char *p = path;
+	while (*p == '/')
+	{
+		std::string key;
+		for (p++; *p != '\0' && *p != '/'; p++)
+		{
+			if (*p != '~')
+			{
+				key.push_back(*p);
+				continue;
+			}
+
+			p++;
+			if (*p == '0')
+			{
+				key.push_back('~');
+			}
+			else if (*p == '1')
+			{
+				key.push_back('/');
+			}
+			else
+			{
+				error = "invalid escape sequence in JSON pointer";
+				return false;
+			}
+		}
+		AddSegment(this->segments, std::move(key), false);
+	}
+	return true;
+}
+
+bool JSONPath::ParseDotted(const char *path, std::string &error)
+{
+	const char *p = path;
+	while (*p != '\0')
+	{
+		if (*p == '[')
+		{
+			std::string key;
+			for (p++; *p >= '0' && *p <= '9'; p++)
+			{
+				key.push_back(*p);
+			}
+			if (*p != ']' || key.empty())
+			{
+				error = "expected array index inside []";
+				return false;
+			}
+			p++;
+
+			AddSegment(this->segments, std::move(key), true);
+			if (!this->segments.back().numeric)
+			{
+				error = "invalid array index";
+				return false;
+			}
+		}
+		else
+		{
+			std::string key;
+			for (; *p != '\0' && *p != '.' && *p != '['; p++)
+			{
+				key.push_back(*p);
+			}
+			if (key.empty())
+			{
+				error = "empty key";
+				return false;
+			}
+			AddSegment(this->segments, std::move(key), false);
+		}
+
+		if (*p == '.')
+		{
+			p++;
+			if (*p == '\0' || *p == '.')
+			{
+				error = "empty key";
+				return false;
+			}
+		}
+		else if (*p != '\0' && *p != '[')
+		{
+			error = "expected '.' or '[' after ']'";
+			return false;
+		}
+	}
+	return true;
+}
+
+json_t *JSONPath::Step(json_t *node, const Segment &segment)
+{
+	if (json_is_object(node) && !segment.bracketed)
+	{
+		return json_object_getn(node, segment.key.c_str(), segment.key.size());
+	}
+
+	if (json_is_array(node) && segment.numeric)
+	{
+		return json_array_get(node, segment.index);
+	}
+
+	return nullptr;
+}
+
+json_t *JSONPath::Get(json_t *root) const
+{
+	json_t *node = root;
+	for (const Segment &segment : this->segments)
+	{
+		if ((node = Step(node, segment)) == nullptr)
+		{
+			return nullptr;
+		}
+	}
+	return node;
+}
+
+json_t *JSONPath::Parent(json_t *root, bool create) const
+{
+	json_t *node = root;
+	for (size_t i = 0; i + 1 < this->segments.size(); i++)
+	{
+		const Segment &segment = this->segments[i];
+		json_t *next = Step(node, segment);
+		if (next != nullptr)
+		{
+			node = next;
+			continue;
+		}
+
+		// Only missing object members are created, array indices have to exist.
+		if (!create || !json_is_object(node) || segment.bracketed)
+		{
+			return nullptr;
+		}
+
+		next = this->segments[i + 1].bracketed ? json_array() : json_object();
+		if (json_object_setn_new(node, segment.key.c_str(), segment.key.size(), next) != 0)
+		{
+			return nullptr;
+		}
+		node = next;
+	}
+	return node;
+}
+
+bool JSONPath::Set(json_t *root, json_t *value) const
+{
+	if (this->segments.empty())
+	{
+		json_decref(value);
+		return false;
+	}
+
+	json_t *parent = this->Parent(root, true);
+	const Segment &last = this->segments.back();
+	if (json_is_object(parent) && !last.bracketed)
+	{
+		return json_object_setn_new(parent, last.key.c_str(), last.key.size(), value) == 0;
+	}
+
+	if (json_is_array(parent))
+	{
+		size_t size = json_array_size(parent);
+		if (last.append || (last.numeric && last.index == size))
+		{
+			return json_array_append_new(parent, value) == 0;
+		}
+		if (last.numeric && last.index < size)
+		{
+			return json_array_set_new(parent, last.index, value) == 0;
+		}
+	}
+
+	json_decref(value);
+	return false;
+}
+
+bool JSONPath::Remove(json_t *root) const
+{
+	if (this->segments.empty())
+	{
+		return false;
+	}
+
+	json_t *parent = this->Parent(root, false);
+	const Segment &last = this->segments.back();
+	if (json_is_object(parent) && !last.bracketed)
+	{
+		return json_object_deln(parent, last.key.c_str(), last.key.size()) == 0;
+	}
+
+	if (json_is_array(parent) && last.numeric)
+	{
+		return json_array_remove(parent, last.index) == 0;
+	}
+
+	return false;
+}
+
+const std::vector<JSONPath::Segment> &JSONPath::GetSegments() const
+{
+	return this->segments;
+}
@@ -0,0 +1,75 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SM_RIPEXT_JSONPATH_H_
+#define SM_RIPEXT_JSONPATH_H_
+
+#include <jansson.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Compiled paths kept by JSONPath::Compile, the cache is cleared when full.
+   Paths already handed out stay valid, they are shared with the caller. */
+#define SM_RIPEXT_JSONPATH_CACHE_SIZE 256
+
+// A parsed path into a JSON document. Two syntaxes are accepted:
+//   JSON Pointer (RFC 6901): /data/players/3/stats/kills
+//   Dotted:                  data.players[3].stats.kills
+class JSONPath
+{
+public:
+	struct Segment
+	{
+		std::string key;
+		size_t index;
+		bool numeric;    /* key is a valid array index */
+		bool bracketed;  /* written as [n], only matches arrays */
+		bool append;     /* "-" in a pointer, one past the last array element */
+	};
+
+	// Returns a cached compiled path, or nullptr and an error message if the syntax is invalid.
+	static std::shared_ptr<const JSONPath> Compile(const char *path, std::string &error);
+
+	json_t *Get(json_t *root) const;
+
+	// Stores value at the path, creating missing parent objects and arrays.
+	// Steals the reference to value, like json_object_set_new.
+	bool Set(json_t *root, json_t *value) const;
+
+	bool Remove(json_t *root) const;
+
+	// Returns the container of the last segment, creating missing parent objects if asked to.
+	json_t *Parent(json_t *root, bool create) const;
+
+	const std::vector<Segment> &GetSegments() const;
+
+private:
+	bool ParsePointer(const char *path, std::string &error);
+	bool ParseDotted(const char *path, std::string &error);
+	static void AddSegment(std::vector<Segment> &segments, std::string key, bool bracketed);
+	static json_t *Step(json_t *node, const Segment &segment);
+
+	std::vector<Segment> segments;
+};
+
+#endif // SM_RIPEXT_JSONPATH_H_
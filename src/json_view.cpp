@@ -0,0 +1,681 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json_view.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SM_RIPEXT_JSONVIEW_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+static inline bool IsStringSpecial(unsigned char c)
+{
+	return c == '"' || c == '\\' || c < 0x20 || c >= 0x80;
+}
+
+// Skips ordinary string characters, stopping at a quote, a backslash, a control
+// character or the first byte of a multi-byte UTF-8 sequence.
+static const char *ScanString(const char *p, const char *end)
+{
+#if defined(SM_RIPEXT_JSONVIEW_SSE2)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i space = _mm_set1_epi8(0x20);
+	while (end - p >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+		// A signed compare catches both control characters and bytes >= 0x80.
+		special = _mm_or_si128(special, _mm_cmplt_epi8(chunk, space));
+
+		int mask = _mm_movemask_epi8(special);
+		if (mask != 0)
+		{
+#if defined(_MSC_VER)
+			unsigned long bit;
+			_BitScanForward(&bit, mask);
+			return p + bit;
+#else
+			return p + __builtin_ctz(mask);
+#endif
+		}
+		p += 16;
+	}
+#endif
+
+	while (p < end && !IsStringSpecial(static_cast<unsigned char>(*p)))
+	{
+		p++;
+	}
+	return p;
+}
+
+static int HexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F')
+	{
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+static int32_t ReadHex4(const char *p)
+{
+	int32_t value = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		int digit = HexValue(p[i]);
+		if (digit < 0)
+		{
+			return -1;
+		}
+		value = (value << 4) | digit;
+	}
+	return value;
+}
+
+static void AppendUTF8(std::string &out, int32_t codepoint)
+{
+	if (codepoint < 0x80)
+	{
+		out.push_back(static_cast<char>(codepoint));
+	}
+	else if (codepoint < 0x800)
+	{
+		out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	}
+	else if (codepoint < 0x10000)
+	{
+		out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	}
+	else
+	{
+		out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	}
+}
+
+// Returns the length of a valid UTF-8 sequence starting at p, or 0.
+static size_t UTF8SequenceLength(const unsigned char *p, const unsigned char *end)
+{
+	size_t length;
+	int32_t codepoint;
+	if (p[0] >= 0xC2 && p[0] <= 0xDF)
+	{
+		length = 2;
+		codepoint = p[0] & 0x1F;
+	}
+	else if (p[0] >= 0xE0 && p[0] <= 0xEF)
+	{
+		length = 3;
+		codepoint = p[0] & 0x0F;
+	}
+	else if (p[0] >= 0xF0 && p[0] <= 0xF4)
+	{
+		length = 4;
+		codepoint = p[0] & 0x07;
+	}
+	else
+	{
+		return 0;
+	}
+
+	if (static_cast<size_t>(end - p) < length)
+	{
+		return 0;
+	}
+
+	for (size_t i = 1; i < length; i++)
+	{
+		if ((p[i] & 0xC0) != 0x80)
+		{
+			return 0;
+		}
+		codepoint = (codepoint << 6) | (p[i] & 0x3F);
+	}
+
+	// Reject overlong forms, surrogates and values past U+10FFFF.
+	if ((length == 3 && codepoint < 0x800) || (length == 4 && codepoint < 0x10000) ||
+		(codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF)
+	{
+		return 0;
+	}
+	return length;
+}
+
+class JSONViewParser
+{
+public:
+	JSONViewParser(JSONViewDocument &document, std::string &error)
+		: document(document), error(error)
+	{
+		this->begin = document.text.data();
+		this->p = this->begin;
+		this->end = this->begin + document.text.size();
+	}
+
+	bool Parse()
+	{
+		this->SkipWhitespace();
+		if (!this->Value(0))
+		{
+			return false;
+		}
+
+		this->SkipWhitespace();
+		if (this->p != this->end)
+		{
+			return this->Fail("end of file expected");
+		}
+		return true;
+	}
+
+private:
+	bool Fail(const char *msg)
+	{
+		this->error = std::string(msg) + " near offset " + std::to_string(this->p - this->begin);
+		return false;
+	}
+
+	void SkipWhitespace()
+	{
+		while (this->p < this->end && (*this->p == ' ' || *this->p == '\t' || *this->p == '\n' || *this->p == '\r'))
+		{
+			this->p++;
+		}
+	}
+
+	uint32_t Push(JSONViewType type)
+	{
+		JSONViewDocument::Node node;
+		node.type = static_cast<uint8_t>(type);
+		node.escaped = 0;
+		node.start = static_cast<uint32_t>(this->p - this->begin);
+		node.length = 0;
+		node.count = 0;
+		node.next = static_cast<uint32_t>(this->document.tape.size() + 1);
+		this->document.tape.push_back(node);
+		return node.next - 1;
+	}
+
+	bool Value(int depth)
+	{
+		if (this->p == this->end)
+		{
+			return this->Fail("unexpected end of input");
+		}
+
+		switch (*this->p)
+		{
+		case '{':
+		case '[':
+			return this->Container(depth);
+		case '"':
+			return this->String();
+		case 't':
+			return this->Literal("true", JSONView_True);
+		case 'f':
+			return this->Literal("false", JSONView_False);
+		case 'n':
+			return this->Literal("null", JSONView_Null);
+		default:
+			return this->Number();
+		}
+	}
+
+	bool Container(int depth)
+	{
+		if (depth >= SM_RIPEXT_JSONVIEW_MAX_DEPTH)
+		{
+			return this->Fail("maximum parsing depth reached");
+		}
+
+		bool object = (*this->p == '{');
+		char close = object ? '}' : ']';
+		uint32_t index = this->Push(object ? JSONView_Object : JSONView_Array);
+		uint32_t count = 0;
+
+		this->p++;
+		this->SkipWhitespace();
+		if (this->p < this->end && *this->p == close)
+		{
+			this->p++;
+		}
+		else
+		{
+			for (;;)
+			{
+				if (object)
+				{
+					if (this->p == this->end || *this->p != '"')
+					{
+						return this->Fail("string or '}' expected");
+					}
+					if (!this->String())
+					{
+						return false;
+					}
+
+					this->SkipWhitespace();
+					if (this->p == this->end || *this->p != ':')
+					{
+						return this->Fail("':' expected");
+					}
+					this->p++;
+					this->SkipWhitespace();
+				}
+
+				if (!this->Value(depth + 1))
+				{
+					return false;
+				}
+				count++;
+
+				this->SkipWhitespace();
+				if (this->p < this->end && *this->p == ',')
+				{
+					this->p++;
+					this->SkipWhitespace();
+					continue;
+				}
+				if (this->p < this->end && *this->p == close)
+				{
+					this->p++;
+					break;
+				}
+				return this->Fail(object ? "'}' expected" : "']' expected");
+			}
+		}
+
+		JSONViewDocument::Node &node = this->document.tape[index];
+		node.count = count;
+		node.length = static_cast<uint32_t>(this->p - this->begin) - node.start;
+		node.next = static_cast<uint32_t>(this->document.tape.size());
+		return true;
+	}
+
+	bool String()
+	{
+		this->p++;
+		uint32_t index = this->Push(JSONView_String);
+		bool escaped = false;
+
+		for (;;)
+		{
+			this->p = ScanString(this->p, this->end);
+			if (this->p == this->end)
+			{
+				return this->Fail("premature end of input in string");
+			}
+
+			unsigned char c = static_cast<unsigned char>(*this->p);
+			if (c == '"')
+			{
+				break;
+			}
+			else if (c == '\\')
+			{
+				escaped = true;
+				if (!this->Escape())
+				{
+					return false;
+				}
+			}
+			else if (c < 0x20)
+			{
+				return this->Fail("control character in string");
+			}
+			else
+			{
+				size_t length = UTF8SequenceLength(reinterpret_cast<const unsigned char *>(this->p), reinterpret_cast<const unsigned char *>(this->end));
+				if (length == 0)
+				{
+					return this->Fail("invalid UTF-8 in string");
+				}
+				this->p += length;
+			}
+		}
+
+		JSONViewDocument::Node &node = this->document.tape[index];
+		node.escaped = escaped;
+		node.length = static_cast<uint32_t>(this->p - this->begin) - node.start;
+		this->p++;
+		return true;
+	}
+
+	bool Escape()
+	{
+		if (this->end - this->p < 2)
+		{
+			return this->Fail("premature end of input in string");
+		}
+
+		switch (this->p[1])
+		{
+		case '"':
+		case '\\':
+		case '/':
+		case 'b':
+		case 'f':
+		case 'n':
+		case 'r':
+		case 't':
+			this->p += 2;
+			return true;
+		case 'u':
+			break;
+		default:
+			return this->Fail("invalid escape");
+		}
+
+		if (this->end - this->p < 6)
+		{
+			return this->Fail("invalid \\u escape");
+		}
+		int32_t value = ReadHex4(this->p + 2);
+		if (value < 0)
+		{
+			return this->Fail("invalid \\u escape");
+		}
+		if (value == 0)
+		{
+			return this->Fail("\\u0000 is not allowed");
+		}
+		this->p += 6;
+
+		if (value >= 0xDC00 && value <= 0xDFFF)
+		{
+			return this->Fail("invalid Unicode low surrogate");
+		}
+		if (value >= 0xD800 && value <= 0xDBFF)
+		{
+			int32_t low = (this->end - this->p >= 6 && this->p[0] == '\\' && this->p[1] == 'u') ? ReadHex4(this->p + 2) : -1;
+			if (low < 0xDC00 || low > 0xDFFF)
+			{
+				return this->Fail("invalid Unicode surrogate pair");
+			}
+			this->p += 6;
+		}
+		return true;
+	}
+
+	bool Literal(const char *word, JSONViewType type)
+	{
+		size_t length = strlen(word);
+		if (static_cast<size_t>(this->end - this->p) < length || memcmp(this->p, word, length) != 0)
+		{
+			return this->Fail("invalid token");
+		}
+
+		uint32_t index = this->Push(type);
+		this->document.tape[index].length = static_cast<uint32_t>(length);
+		this->p += length;
+		return true;
+	}
+
+	bool Digits()
+	{
+		const char *start = this->p;
+		while (this->p < this->end && *this->p >= '0' && *this->p <= '9')
+		{
+			this->p++;
+		}
+		return this->p != start;
+	}
+
+	bool Number()
+	{
+		uint32_t index = this->Push(JSONView_Integer);
+
+		if (this->p < this->end && *this->p == '-')
+		{
+			this->p++;
+		}
+
+		if (this->p < this->end && *this->p == '0')
+		{
+			this->p++;
+			if (this->p < this->end && *this->p >= '0' && *this->p <= '9')
+			{
+				return this->Fail("invalid token");
+			}
+		}
+		else if (!this->Digits())
+		{
+			return this->Fail("invalid token");
+		}
+
+		bool real = false;
+		if (this->p < this->end && *this->p == '.')
+		{
+			this->p++;
+			real = true;
+			if (!this->Digits())
+			{
+				return this->Fail("invalid number");
+			}
+		}
+
+		if (this->p < this->end && (*this->p == 'e' || *this->p == 'E'))
+		{
+			this->p++;
+			real = true;
+			if (this->p < this->end && (*this->p == '+' || *this->p == '-'))
+			{
+				this->p++;
+			}
+			if (!this->Digits())
+			{
+				return this->Fail("invalid number");
+			}
+		}
+
+		JSONViewDocument::Node &node = this->document.tape[index];
+		node.type = static_cast<uint8_t>(real ? JSONView_Real : JSONView_Integer);
+		node.length = static_cast<uint32_t>(this->p - this->begin) - node.start;
+		return true;
+	}
+
+	JSONViewDocument &document;
+	std::string &error;
+	const char *begin;
+	const char *p;
+	const char *end;
+};
+
+std::shared_ptr<JSONViewDocument> JSONViewDocument::Parse(const char *text, size_t length, std::string &error)
+{
+	if (length >= UINT32_MAX)
+	{
+		error = "input too large";
+		return nullptr;
+	}
+
+	auto document = std::make_shared<JSONViewDocument>();
+	document->text.assign(text, length);
+
+	// Dense payloads average a value every few bytes, this avoids most regrowth.
+	document->tape.reserve(length / 6 + 1);
+
+	JSONViewParser parser(*document, error);
+	if (!parser.Parse())
+	{
+		return nullptr;
+	}
+
+	document->tape.shrink_to_fit();
+	return document;
+}
+
+const JSONViewDocument::Node &JSONViewDocument::GetNode(uint32_t index) const
+{
+	return this->tape[index];
+}
+
+bool JSONViewDocument::KeyEquals(uint32_t index, const std::string &key) const
+{
+	const Node &node = this->tape[index];
+	if (!node.escaped)
+	{
+		return node.length == key.size() && memcmp(this->text.data() + node.start, key.data(), key.size()) == 0;
+	}
+	return this->GetString(index) == key;
+}
+
+uint32_t JSONViewDocument::Step(uint32_t index, const JSONPath::Segment &segment) const
+{
+	const Node &node = this->tape[index];
+	if (node.type == JSONView_Object && !segment.bracketed)
+	{
+		// json_loads keeps the last of duplicate keys, so the view does too.
+		uint32_t found = npos;
+		uint32_t child = index + 1;
+		for (uint32_t i = 0; i < node.count; i++)
+		{
+			if (this->KeyEquals(child, segment.key))
+			{
+				found = child + 1;
+			}
+			child = this->tape[child + 1].next;
+		}
+		return found;
+	}
+	else if (node.type == JSONView_Array && segment.numeric && segment.index < node.count)
+	{
+		uint32_t child = index + 1;
+		for (size_t i = 0; i < segment.index; i++)
+		{
+			child = this->tape[child].next;
+		}
+		return child;
+	}
+	return npos;
+}
+
+uint32_t JSONViewDocument::Find(uint32_t index, const JSONPath &path) const
+{
+	for (const JSONPath::Segment &segment : path.GetSegments())
+	{
+		if ((index = this->Step(index, segment)) == npos)
+		{
+			break;
+		}
+	}
+	return index;
+}
+
+std::string JSONViewDocument::GetString(uint32_t index) const
+{
+	const Node &node = this->tape[index];
+	const char *p = this->text.data() + node.start;
+	const char *end = p + node.length;
+	if (!node.escaped)
+	{
+		return std::string(p, end);
+	}
+
+	// Escapes were validated while parsing.
+	std::string result;
+	result.reserve(node.length);
+	while (p < end)
+	{
+		if (*p != '\\')
+		{
+			result.push_back(*p++);
+			continue;
+		}
+
+		char c = p[1];
+		p += 2;
+		switch (c)
+		{
+		case 'b': result.push_back('\b'); break;
+		case 'f': result.push_back('\f'); break;
+		case 'n': result.push_back('\n'); break;
+		case 'r': result.push_back('\r'); break;
+		case 't': result.push_back('\t'); break;
+		case 'u':
+		{
+			int32_t value = ReadHex4(p);
+			p += 4;
+			if (value >= 0xD800 && value <= 0xDBFF)
+			{
+				int32_t low = ReadHex4(p + 2);
+				p += 6;
+				value = 0x10000 + ((value - 0xD800) << 10) + (low - 0xDC00);
+			}
+			AppendUTF8(result, value);
+			break;
+		}
+		default: result.push_back(c); break;
+		}
+	}
+	return result;
+}
+
+json_int_t JSONViewDocument::GetInteger(uint32_t index) const
+{
+	// The text is NUL-terminated and a number is always followed by a delimiter.
+	return strtoll(this->text.c_str() + this->tape[index].start, nullptr, 10);
+}
+
+double JSONViewDocument::GetNumber(uint32_t index) const
+{
+	const Node &node = this->tape[index];
+	double value;
+	json_strtod(this->text.data() + node.start, node.length, &value);
+	return value;
+}
+
+json_t *JSONViewDocument::ToJSON(uint32_t index) const
+{
+	const Node &node = this->tape[index];
+	size_t start = node.start;
+	size_t length = node.length;
+	if (node.type == JSONView_String)
+	{
+		start--;
+		length += 2;
+	}
+	return json_loadb(this->text.data() + start, length, JSON_DECODE_ANY, nullptr);
+}
+
+size_t JSONViewDocument::GetMemoryUsage() const
+{
+	return sizeof(JSONViewDocument) + this->text.capacity() + this->tape.capacity() * sizeof(Node);
+}
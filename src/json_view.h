@@ -0,0 +1,99 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SM_RIPEXT_JSONVIEW_H_
+#define SM_RIPEXT_JSONVIEW_H_
+
+#include "json_path.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Same nesting limit as jansson's parser */
+#define SM_RIPEXT_JSONVIEW_MAX_DEPTH 2048
+
+enum JSONViewType
+{
+	JSONView_Object,
+	JSONView_Array,
+	JSONView_String,
+	JSONView_Integer,
+	JSONView_Real,
+	JSONView_True,
+	JSONView_False,
+	JSONView_Null
+};
+
+// A read-only JSON document parsed into a single tape. Every value is one node in
+// document order, containers are followed by their children (keys and values
+// alternate in objects) and record where their subtree ends, so skipping a value
+// is a single jump. Strings and numbers are not copied or converted until read.
+//
+// The parser is a scalar recursive-descent parser writing straight to the tape, SSE2
+// only skips plain string bytes. It is not a vectorized structural-index parser like
+// simdjson. Object lookups compare every member key in turn and array elements are
+// reached by walking their preceding siblings, which is cheap for the few lookups a
+// view is meant for. bench/json_view_bench.cpp compares it with json_loads.
+class JSONViewDocument
+{
+public:
+	struct Node
+	{
+		uint8_t type;
+		uint8_t escaped;  /* string contains escape sequences */
+		uint32_t next;    /* tape index following this value's subtree */
+		uint32_t start;   /* offset of the value in the text, inside the quotes for strings */
+		uint32_t length;
+		uint32_t count;   /* container members */
+	};
+
+	// Returns nullptr and an error message on invalid JSON.
+	static std::shared_ptr<JSONViewDocument> Parse(const char *text, size_t length, std::string &error);
+
+	const Node &GetNode(uint32_t index) const;
+	uint32_t Find(uint32_t index, const JSONPath &path) const;
+	std::string GetString(uint32_t index) const;
+	json_int_t GetInteger(uint32_t index) const;
+	double GetNumber(uint32_t index) const;
+	json_t *ToJSON(uint32_t index) const;
+	size_t GetMemoryUsage() const;
+
+	static const uint32_t npos = UINT32_MAX;
+
+private:
+	friend class JSONViewParser;
+
+	uint32_t Step(uint32_t index, const JSONPath::Segment &segment) const;
+	bool KeyEquals(uint32_t index, const std::string &key) const;
+
+	std::string text;
+	std::vector<Node> tape;
+};
+
+// What a JSONView handle points at: a node inside a shared document.
+struct JSONView
+{
+	std::shared_ptr<JSONViewDocument> document;
+	uint32_t index;
+};
+
+#endif // SM_RIPEXT_JSONVIEW_H_
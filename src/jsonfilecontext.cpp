@@ -0,0 +1,171 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jsonfilecontext.h"
+
+JSONFileContext::JSONFileContext(const std::string &path, json_t *data, size_t flags, IdentityToken_t *owner,
+								 IChangeableForward *forward, cell_t value)
+	: path(path), isSave(data != nullptr), data(data), flags(flags), owner(owner), forward(forward), value(value)
+{
+	work.data = this;
+}
+
+JSONFileContext::~JSONFileContext()
+{
+	forwards->ReleaseForward(forward);
+
+	/* A saved copy shares nothing with the original, deep copies duplicate interned keys */
+	json_decref(data);
+}
+
+void JSONFileContext::Perform()
+{
+	if (isSave)
+	{
+		Save();
+	}
+	else
+	{
+		Load();
+	}
+}
+
+void JSONFileContext::Load()
+{
+	json_error_t jsonError;
+	data = json_load_file(path.c_str(), flags, &jsonError);
+	if (data == nullptr)
+	{
+		char buffer[JSON_ERROR_TEXT_LENGTH + 64];
+		snprintf(buffer, sizeof(buffer), "Invalid JSON in line %d, column %d: %s", jsonError.line, jsonError.column, jsonError.text);
+		error = buffer;
+		return;
+	}
+
+	success = true;
+}
+
+void JSONFileContext::Save()
+{
+	char *text = json_dumps(data, flags);
+	if (text == nullptr)
+	{
+		error = "Could not encode JSON";
+		return;
+	}
+
+	/* Write a temporary file next to the target and rename it over the target, so readers never see a partial file */
+	std::string tempPath = path + ".tmp";
+	uv_fs_t req;
+
+	int fd = uv_fs_open(g_Loop, &req, tempPath.c_str(), UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC, 0644, nullptr);
+	uv_fs_req_cleanup(&req);
+	if (fd < 0)
+	{
+		error = "Could not open file " + tempPath + ": " + uv_strerror(fd);
+		free(text);
+		return;
+	}
+
+	size_t length = strlen(text);
+	size_t written = 0;
+	int result = 0;
+	while (written < length)
+	{
+		uv_buf_t buf = uv_buf_init(text + written, (unsigned int)(length - written));
+		result = uv_fs_write(g_Loop, &req, fd, &buf, 1, -1, nullptr);
+		uv_fs_req_cleanup(&req);
+		if (result < 0)
+		{
+			break;
+		}
+		written += (size_t)result;
+	}
+	free(text);
+
+	if (result >= 0)
+	{
+		result = uv_fs_fsync(g_Loop, &req, fd, nullptr);
+		uv_fs_req_cleanup(&req);
+	}
+
+	uv_fs_close(g_Loop, &req, fd, nullptr);
+	uv_fs_req_cleanup(&req);
+
+	if (result >= 0)
+	{
+		result = uv_fs_rename(g_Loop, &req, tempPath.c_str(), path.c_str(), nullptr);
+		uv_fs_req_cleanup(&req);
+	}
+
+	if (result < 0)
+	{
+		error = "Could not write file " + path + ": " + uv_strerror(result);
+
+		uv_fs_unlink(g_Loop, &req, tempPath.c_str(), nullptr);
+		uv_fs_req_cleanup(&req);
+		return;
+	}
+
+	success = true;
+}
+
+void JSONFileContext::OnCompleted()
+{
+	/* Return early if the plugin was unloaded while the thread was running */
+	if (forward->GetFunctionCount() == 0)
+	{
+		return;
+	}
+
+	if (isSave)
+	{
+		forward->PushCell(success);
+		forward->PushCell(value);
+		forward->PushString(error.c_str());
+		forward->Execute(nullptr);
+		return;
+	}
+
+	Handle_t hndlObject = BAD_HANDLE;
+	if (data != nullptr)
+	{
+		HandleError err;
+		HandleSecurity sec(owner, myself->GetIdentity());
+		hndlObject = handlesys->CreateHandleEx(htJSON, data, &sec, nullptr, &err);
+		if (hndlObject == BAD_HANDLE)
+		{
+			char buffer[64];
+			snprintf(buffer, sizeof(buffer), "Could not create object handle (error %d)", err);
+			error = buffer;
+		}
+		else
+		{
+			/* The plugin owns the document now */
+			data = nullptr;
+		}
+	}
+
+	forward->PushCell(hndlObject);
+	forward->PushCell(value);
+	forward->PushString(error.c_str());
+	forward->Execute(nullptr);
+}
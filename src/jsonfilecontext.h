@@ -0,0 +1,59 @@
+/**
+ * vim: set ts=4 :
+ * =============================================================================
+ * SourceMod REST in Pawn Extension
+ * Copyright 2017-2022 Erik Minekus
+ * =============================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SM_RIPEXT_JSONFILECONTEXT_H_
+#define SM_RIPEXT_JSONFILECONTEXT_H_
+
+#include <stdio.h>
+#include "extension.h"
+
+class JSONFileContext
+{
+public:
+	/* Loads the file, or saves data when it's not null. data is a private copy owned by the context. */
+	JSONFileContext(const std::string &path, json_t *data, size_t flags, IdentityToken_t *owner,
+					IChangeableForward *forward, cell_t value);
+	~JSONFileContext();
+
+	/* Runs on a libuv worker thread */
+	void Perform();
+
+	/* Runs on the game thread */
+	void OnCompleted();
+
+	uv_work_t work;
+
+private:
+	void Load();
+	void Save();
+
+	const std::string path;
+	const bool isSave;
+	json_t *data;
+	size_t flags;
+	IdentityToken_t *owner;
+	IChangeableForward *forward;
+	cell_t value;
+	bool success = false;
+	std::string error;
+};
+
+#endif // SM_RIPEXT_JSONFILECONTEXT_H_
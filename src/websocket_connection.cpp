@@ -2,151 +2,568 @@
 #include "websocket_eventloop.h"
 #include <boost/asio/strand.hpp>
 
-websocket_connection::websocket_connection(std::string address, std::string endpoint, uint16_t port) : websocket_connection_base(address, endpoint, port)
+template <class NextLayer>
+websocket_connection<NextLayer>::websocket_connection(std::string address, std::string endpoint, uint16_t port)
+    : websocket_connection_base(address, endpoint, port), strand(boost::asio::make_strand(event_loop.get_context())), reconnect_timer(strand), ping_timer(strand)
 {
-    this->ws = std::make_unique<websocket::stream<beast::tcp_stream>>(boost::asio::make_strand(event_loop.get_context()));
-    this->work = std::make_unique<boost::asio::io_context::work>(event_loop.get_context());
-    this->resolver = std::make_shared<tcp::resolver>(event_loop.get_context());
+    this->reset_stream();
 }
 
-void websocket_connection::connect()
+template <class NextLayer>
+std::shared_ptr<websocket_connection<NextLayer>> websocket_connection<NextLayer>::self()
 {
-    char s_port[8];
-    std::snprintf(s_port, sizeof(s_port), "%hu", this->port);
-    tcp::resolver::query query(this->address.c_str(), s_port);
+    return std::static_pointer_cast<websocket_connection>(this->shared_from_this());
+}
+
+template <class NextLayer>
+bool websocket_connection<NextLayer>::aborted() const
+{
+    return this->pending_delete || this->user_closed;
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::reset_stream()
+{
+    // A websocket stream cannot be reused once it failed, and the TLS state has to be rebuilt too.
+    if constexpr (is_ssl)
+    {
+        this->ws = std::make_unique<websocket::stream<NextLayer>>(this->strand, event_loop.get_ssl_context());
+    }
+    else
+    {
+        this->ws = std::make_unique<websocket::stream<NextLayer>>(this->strand);
+    }
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::connect()
+{
+    if (this->server_role)
+    {
+        g_RipExt.LogError("WebSocket %s:%d was accepted by a server and cannot connect", this->address.c_str(), this->port);
+        return;
+    }
 
-    this->resolver->async_resolve(query, beast::bind_front_handler(&websocket_connection::on_resolve, this));
+    boost::asio::post(this->strand, [self = this->self()]()
+                      {
+        self->user_closed = false;
+        self->reset_reconnect();
+        self->resolve(); });
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::resolve()
+{
+    this->start_handshake_clock();
+    event_loop.get_dns_cache().async_resolve(this->address, this->port, [self = this->self()](beast::error_code ec, tcp::resolver::results_type results)
+                                             { boost::asio::post(self->strand, beast::bind_front_handler(&websocket_connection::on_resolve, self, ec, results)); });
     g_RipExt.LogMessage("Init Connect %s:%d", address.c_str(), this->port);
 }
 
-void websocket_connection::on_resolve(beast::error_code ec, tcp::resolver::results_type results)
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_resolve(beast::error_code ec, tcp::resolver::results_type results)
 {
+    if (this->aborted())
+    {
+        return;
+    }
+
     if (ec)
     {
         g_RipExt.LogError("Error resolving %s: %d %s", this->address.c_str(), ec.value(), ec.message().c_str());
-        if (this->disconnect_callback)
-        {
-            this->disconnect_callback->operator()();
-        }
-        this->ws_connect = false;
+        this->on_disconnect();
         return;
     }
 
-    beast::get_lowest_layer(*this->ws).expires_after(std::chrono::seconds(30));
-    beast::get_lowest_layer(*this->ws).async_connect(results, beast::bind_front_handler(&websocket_connection::on_connect, this));
+    this->arm_connect_timeout();
+    beast::get_lowest_layer(*this->ws).async_connect(results, beast::bind_front_handler(&websocket_connection::on_connect, this->self()));
 }
 
-void websocket_connection::on_connect(beast::error_code ec, tcp::resolver::results_type::endpoint_type ep)
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_connect(beast::error_code ec, tcp::resolver::results_type::endpoint_type ep)
 {
+    if (this->aborted())
+    {
+        return;
+    }
+
     if (ec)
     {
         g_RipExt.LogError("Error connecting to %s: %d %s", this->address.c_str(), ec.value(), ec.message().c_str());
-        if (this->disconnect_callback)
+        this->on_disconnect();
+        return;
+    }
+
+    if constexpr (is_ssl)
+    {
+        // SNI carries the bare host name, it is also the key the TLS session is cached under.
+        this->arm_connect_timeout();
+        if (!SSL_set_tlsext_host_name(this->ws->next_layer().native_handle(), this->address.c_str()))
         {
-            this->disconnect_callback->operator()();
+            ec = beast::error_code(static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category());
+            g_RipExt.LogError("SSL Error: %d %s", ec.value(), ec.message().c_str());
+            this->on_disconnect();
+            return;
         }
-        this->ws_connect = false;
+        event_loop.resume_tls_session(this->ws->next_layer().native_handle(), this->address);
+
+        this->ws->next_layer().async_handshake(
+            boost::asio::ssl::stream_base::client,
+            beast::bind_front_handler(
+                &websocket_connection::on_ssl_handshake,
+                this->self()));
+    }
+    else
+    {
+        this->handshake();
+    }
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_ssl_handshake(beast::error_code ec)
+{
+    if (this->aborted())
+    {
+        return;
+    }
+
+    if (ec)
+    {
+        g_RipExt.LogError("SSL Handshake Error: %d %s", ec.value(), ec.message().c_str());
+        this->on_disconnect();
         return;
     }
+
+    this->handshake();
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::arm_connect_timeout()
+{
+    // Covers the TCP connect and the TLS handshake, the websocket handshake has its own timeout.
+    int64_t timeout = this->connect_timeout_ms;
+    if (timeout > 0)
+    {
+        beast::get_lowest_layer(*this->ws).expires_after(std::chrono::milliseconds(timeout));
+    }
+    else
+    {
+        beast::get_lowest_layer(*this->ws).expires_never();
+    }
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::handshake()
+{
+    // The websocket timeout option takes over from the TCP expiry from here on.
     beast::get_lowest_layer(*this->ws).expires_never();
 
-    auto timeout = websocket::stream_base::timeout::suggested(beast::role_type::client);
-    timeout.keep_alive_pings = true;
+    websocket::stream_base::timeout timeout;
+    this->configure_timeout(timeout);
+    this->ws->set_option(timeout);
+    // The decorator and control callback are owned by the stream, so they capture `this`
+    // rather than the shared pointer to avoid a reference cycle.
     this->ws->set_option(websocket::stream_base::decorator([this](websocket::request_type &req)
                                                            { this->add_headers(req); }));
 
-    this->ws->async_handshake(this->address, this->endpoint.c_str(), beast::bind_front_handler(&websocket_connection::on_handshake, this));
+    this->response = websocket::response_type();
+    this->ws->async_handshake(this->response, this->address, this->endpoint.c_str(), beast::bind_front_handler(&websocket_connection::on_handshake, this->self()));
 }
 
-void websocket_connection::on_handshake(beast::error_code ec)
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_handshake(beast::error_code ec)
 {
+    if (this->aborted())
+    {
+        return;
+    }
+
     if (ec)
     {
         g_RipExt.LogError("WebSocket Handshake Error: %d %s", ec.value(), ec.message().c_str());
-        if (this->disconnect_callback)
-        {
-            this->disconnect_callback->operator()();
-        }
-        this->ws_connect = false;
+        this->on_disconnect();
         return;
     }
 
+    if (!this->server_role && !this->accept_response(std::move(this->response)))
+    {
+        beast::get_lowest_layer(*this->ws).socket().close(ec);
+        this->on_disconnect();
+        return;
+    }
+
+    this->stop_handshake_clock();
+    this->reads_paused = false;
+    this->reset_reconnect();
+    this->ws->control_callback([this](websocket::frame_type kind, beast::string_view payload)
+                               { this->on_control(kind, payload); });
+    this->start_ping_timer();
+    int64_t message_max = this->read_message_max;
+    if (message_max >= 0)
+    {
+        this->ws->read_message_max(static_cast<std::uint64_t>(message_max));
+    }
+
     this->buffer.clear();
     if (this->connect_callback)
     {
         this->connect_callback->operator()();
     }
 
-    this->ws->async_read(this->buffer, beast::bind_front_handler(&websocket_connection::on_read, this));
+    if (!this->server_role)
+    {
+        this->read();
+    }
     this->ws_connect = true;
     g_RipExt.LogMessage("On Handshaked %s:%d", address.c_str(), this->port);
+
+    // Flush anything written while the connection was down. A write aborted by the
+    // disconnect may still be completing, its on_write continues with the queue.
+    if (!this->write_in_progress && !this->write_queue.empty())
+    {
+        this->do_write();
+    }
 }
 
-void websocket_connection::on_write(beast::error_code ec, size_t bytes_transferred)
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_write(beast::error_code ec, size_t bytes_transferred)
 {
+    // Only the finished write may pop its message, the front entry was kept for it.
+    this->pop_message();
+    this->write_in_progress = false;
     if (ec)
     {
         g_RipExt.LogError("WebSocket write error: %d %s", ec.value(), ec.message().c_str());
         return;
     }
+
+    this->record_write(bytes_transferred);
+
+    if (this->write_callback)
+    {
+        this->write_callback->operator()(bytes_transferred);
+    }
+
+    if (this->ws_connect && !this->write_queue.empty())
+    {
+        this->do_write();
+    }
 }
 
-void websocket_connection::on_read(beast::error_code ec, size_t bytes_transferred)
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_read(beast::error_code ec, size_t bytes_transferred)
 {
     if (ec)
     {
-        if (this->pending_delete)
-        {
-            delete this;
-        }
-        else
+        if (!this->pending_delete)
         {
             g_RipExt.LogError("WebSocket read error: %d %s", ec.value(), ec.message().c_str());
-            if (this->disconnect_callback)
-            {
-                this->disconnect_callback->operator()();
-            }
-            this->ws_connect = false;
+            this->on_disconnect();
         }
         return;
     }
 
-    if (this->read_callback)
+    if (this->reading_fragments)
+    {
+        if (this->fragment_callback)
+        {
+            this->inbound_acquire(bytes_transferred);
+            auto buffer = reinterpret_cast<uint8_t *>(malloc(bytes_transferred));
+            memcpy(buffer, reinterpret_cast<const uint8_t *>(this->buffer.data().data()), bytes_transferred);
+
+            this->fragment_callback->operator()(buffer, bytes_transferred, this->ws->is_message_done());
+        }
+    }
+    else if (this->read_callback)
     {
+        this->inbound_acquire(bytes_transferred);
         auto buffer = reinterpret_cast<uint8_t *>(malloc(bytes_transferred));
         memcpy(buffer, reinterpret_cast<const uint8_t *>(this->buffer.data().data()), bytes_transferred);
 
         this->read_callback->operator()(buffer, bytes_transferred);
     }
+    this->record_read(bytes_transferred, !this->reading_fragments || this->ws->is_message_done());
     this->buffer.consume(bytes_transferred);
 
-    this->ws->async_read(this->buffer, beast::bind_front_handler(&websocket_connection::on_read, this));
+    if (this->over_inbound_budget())
+    {
+        // Leave the socket unread until the game thread catches up. The budget may have
+        // been released while pausing, in which case nobody else will resume us.
+        this->reads_paused = true;
+        if (this->over_inbound_budget() || !this->reads_paused.exchange(false))
+        {
+            return;
+        }
+    }
+
+    this->read();
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::read()
+{
+    // In streaming mode the plugin gets each piece as it arrives, so the buffer never
+    // holds more than one chunk no matter how large the message is.
+    this->reading_fragments = this->stream_reads;
+    if (this->reading_fragments)
+    {
+        this->ws->async_read_some(this->buffer, WEBSOCKET_READ_CHUNK_SIZE, beast::bind_front_handler(&websocket_connection::on_read, this->self()));
+    }
+    else
+    {
+        this->ws->async_read(this->buffer, beast::bind_front_handler(&websocket_connection::on_read, this->self()));
+    }
 }
 
-void websocket_connection::on_close(beast::error_code ec)
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_close(beast::error_code ec)
 {
     if (ec)
     {
         g_RipExt.LogError("WebSocket close error: %d %s", ec.value(), ec.message().c_str());
-        if (this->pending_delete)
+    }
+    this->ws_connect = false;
+
+    // Drop the registry's reference, outstanding handlers keep the connection alive until they finish.
+    if (this->pending_delete)
+    {
+        event_loop.remove_connection(this);
+    }
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_disconnect()
+{
+    this->ws_connect = false;
+    this->ping_in_progress = false;
+    this->ping_timer.cancel();
+    if (this->pending_delete)
+    {
+        return;
+    }
+
+    if (this->disconnect_callback)
+    {
+        this->disconnect_callback->operator()();
+    }
+
+    if (this->user_closed)
+    {
+        return;
+    }
+
+    if (this->server_role)
+    {
+        this->clear_write_queue();
+        return;
+    }
+
+    std::chrono::milliseconds delay;
+    if (!this->next_reconnect_delay(delay))
+    {
+        this->clear_write_queue();
+        return;
+    }
+
+    g_RipExt.LogMessage("Reconnecting to %s:%d in %lld ms", this->address.c_str(), this->port, static_cast<long long>(delay.count()));
+    this->reconnect_timer.expires_after(delay);
+    this->reconnect_timer.async_wait(beast::bind_front_handler(&websocket_connection::on_reconnect_timer, this->self()));
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_reconnect_timer(beast::error_code ec)
+{
+    if (ec || this->aborted())
+    {
+        return;
+    }
+
+    this->reconnects++;
+    this->reset_stream();
+    this->resolve();
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::start_ping_timer()
+{
+    int64_t interval = this->ping_interval_ms;
+    if (interval <= 0)
+    {
+        return;
+    }
+
+    this->ping_timer.expires_after(std::chrono::milliseconds(interval));
+    this->ping_timer.async_wait(beast::bind_front_handler(&websocket_connection::on_ping_timer, this->self()));
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_ping_timer(beast::error_code ec)
+{
+    if (ec || !this->ws_connect)
+    {
+        return;
+    }
+
+    // Skip this round if the previous ping is still being written, beast only allows one at a time.
+    if (!this->ping_in_progress)
+    {
+        this->ping_in_progress = true;
+        this->ws->async_ping(websocket::ping_data(this->make_ping_payload()), beast::bind_front_handler(&websocket_connection::on_ping, this->self()));
+    }
+
+    this->start_ping_timer();
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::on_ping(beast::error_code ec)
+{
+    this->ping_in_progress = false;
+    if (ec && ec != boost::asio::error::operation_aborted)
+    {
+        g_RipExt.LogError("WebSocket ping error: %d %s", ec.value(), ec.message().c_str());
+    }
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::write(std::string data, bool binary)
+{
+    // Beast allows a single outstanding async_write per stream, and the frame type is
+    // a stream-wide setting, so writes are queued and issued one at a time on the strand.
+    boost::asio::post(this->strand, [self = this->self(), data = std::move(data), binary]() mutable
+                      { self->enqueue_write(std::move(data), binary); });
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::write_json(json_t *object, size_t flags)
+{
+    // The object is a private copy, so it can be serialized here without racing the game thread.
+    boost::asio::post(this->strand, [self = this->self(), object, flags]()
+                      {
+        std::string data;
+        bool serialized = self->serialize_json(object, flags, data);
+        json_decref(object);
+        if (!serialized)
         {
-            delete this;
+            g_RipExt.LogError("WebSocket %s:%d could not serialize JSON message", self->address.c_str(), self->port);
+            return;
         }
+
+        self->enqueue_write(std::move(data), false); });
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::enqueue_write(std::string data, bool binary)
+{
+    this->queue_message(std::move(data), binary);
+    if (this->ws_connect && !this->write_in_progress && !this->write_queue.empty())
+    {
+        this->do_write();
     }
-    this->ws_connect = false;
 }
 
-void websocket_connection::write(boost::asio::const_buffer buffer)
+template <class NextLayer>
+void websocket_connection<NextLayer>::do_write()
+{
+    auto &message = this->write_queue.front();
+    this->write_in_progress = true;
+    this->ws->binary(message.binary);
+    this->ws->async_write(boost::asio::buffer(message.data), beast::bind_front_handler(&websocket_connection::on_write, this->self()));
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::close()
+{
+    boost::asio::post(this->strand, [self = this->self()]()
+                      {
+        self->user_closed = true;
+        self->reconnect_timer.cancel();
+        self->ping_timer.cancel();
+        if (!self->ws_connect)
+        {
+            // Nothing to close gracefully, abort whichever connect step is still pending.
+            beast::error_code ec;
+            beast::get_lowest_layer(*self->ws).socket().close(ec);
+            self->on_close(beast::error_code());
+            return;
+        }
+
+        self->ws->async_close(websocket::close_code::normal, beast::bind_front_handler(&websocket_connection::on_close, self)); });
+}
+
+template <class NextLayer>
+tcp::socket &websocket_connection<NextLayer>::accept_socket()
 {
-    this->ws->async_write(buffer, beast::bind_front_handler(&websocket_connection::on_write, this));
+    return beast::get_lowest_layer(*this->ws).socket();
 }
 
-void websocket_connection::close()
+template <class NextLayer>
+void websocket_connection<NextLayer>::accept()
 {
-    this->ws->async_close(websocket::close_code::normal, beast::bind_front_handler(&websocket_connection::on_close, this));
+    this->server_role = true;
+    beast::error_code ec;
+    auto remote = this->accept_socket().remote_endpoint(ec);
+    if (!ec)
+    {
+        this->address = remote.address().to_string();
+        this->port = remote.port();
+    }
+
+    boost::asio::post(this->strand, [self = this->self()]()
+                      {
+        if constexpr (is_ssl)
+        {
+            // Servers only listen for plain ws://, meant for local processes.
+            g_RipExt.LogError("WebSocket %s:%d TLS is not supported for accepted connections", self->address.c_str(), self->port);
+            return;
+        }
+
+        self->start_handshake_clock();
+        websocket::stream_base::timeout timeout;
+        self->configure_timeout(timeout);
+        self->ws->set_option(timeout);
+        self->ws->set_option(websocket::stream_base::decorator([](websocket::response_type &res)
+                                                               { websocket_connection_base::add_response_headers(res); }));
+        self->ws->async_accept(beast::bind_front_handler(&websocket_connection::on_handshake, self)); });
+}
+
+template <class NextLayer>
+void websocket_connection<NextLayer>::start_reading()
+{
+    boost::asio::post(this->strand, [self = this->self()]()
+                      {
+        if (self->ws_connect && !self->aborted())
+        {
+            self->read();
+        } });
 }
 
-bool websocket_connection::socket_open()
+template <class NextLayer>
+void websocket_connection<NextLayer>::resume_reads()
+{
+    boost::asio::post(this->strand, [self = this->self()]()
+                      {
+        if (self->over_inbound_budget() || !self->reads_paused.exchange(false))
+        {
+            return;
+        }
+
+        if (self->ws_connect && !self->aborted())
+        {
+            self->read();
+        } });
+}
+
+template <class NextLayer>
+size_t websocket_connection<NextLayer>::approx_size()
+{
+    return sizeof(*this) - sizeof(websocket_connection_base) + sizeof(websocket::stream<NextLayer>) + websocket_connection_base::approx_size();
+}
+
+template <class NextLayer>
+bool websocket_connection<NextLayer>::socket_open()
 {
     return this->ws->is_open();
-}
\ No newline at end of file
+}
+
+template class websocket_connection<beast::tcp_stream>;
+template class websocket_connection<beast::ssl_stream<beast::tcp_stream>>;
@@ -1,33 +1,74 @@
 #pragma once
 #include <boost/beast/core.hpp>
+#include <boost/beast/ssl.hpp>
 #include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio.hpp>
 #include <memory>
+#include <type_traits>
 #include "websocket_connection_base.h"
 
 namespace websocket = boost::beast::websocket;
 namespace beast = boost::beast;
 using tcp = boost::asio::ip::tcp;
 
+// A client connection over any next layer stream. The TLS handshake is the only step
+// that differs between ws:// and wss://, everything else is shared.
+template <class NextLayer>
 class websocket_connection : public websocket_connection_base
 {
 public:
     websocket_connection(std::string address, std::string endpoint, uint16_t port);
     void connect();
-    void write(boost::asio::const_buffer buffer);
+    void write(std::string data, bool binary);
+    void write_json(json_t *object, size_t flags);
     void close();
 
+    // Server side: the acceptor fills accept_socket(), accept() then runs the upgrade.
+    // Reads only start once start_reading() is called, so the plugin can install its
+    // callbacks before the first message is delivered.
+    tcp::socket &accept_socket();
+    void accept();
+    void start_reading();
+    size_t approx_size();
+
+protected:
+    void resume_reads();
+
 private:
+    static constexpr bool is_ssl = !std::is_same<NextLayer, beast::tcp_stream>::value;
+
+    std::shared_ptr<websocket_connection> self();
+    bool aborted() const;
+
+    void reset_stream();
+    void resolve();
     void on_resolve(beast::error_code ec, tcp::resolver::results_type results);
     void on_connect(beast::error_code ec, tcp::resolver::results_type::endpoint_type ep);
+    void on_ssl_handshake(beast::error_code ec);
+    void arm_connect_timeout();
+    void handshake();
     void on_handshake(beast::error_code ec);
+    void enqueue_write(std::string data, bool binary);
+    void do_write();
     void on_write(beast::error_code ec, size_t bytes_transferred);
+    void read();
     void on_read(beast::error_code ec, size_t bytes_transferred);
     void on_close(beast::error_code ec);
+    void on_disconnect();
+    void on_reconnect_timer(beast::error_code ec);
+    void start_ping_timer();
+    void on_ping_timer(beast::error_code ec);
+    void on_ping(beast::error_code ec);
     bool socket_open();
 
-    std::unique_ptr<websocket::stream<beast::tcp_stream>> ws;
-    std::unique_ptr<boost::asio::io_context::work> work;
-    std::shared_ptr<tcp::resolver> resolver;
-};
\ No newline at end of file
+    boost::asio::strand<boost::asio::io_context::executor_type> strand;
+    boost::asio::steady_timer reconnect_timer;
+    boost::asio::steady_timer ping_timer;
+    std::unique_ptr<websocket::stream<NextLayer>> ws;
+    websocket::response_type response;
+};
+
+using websocket_connection_plain = websocket_connection<beast::tcp_stream>;
+using websocket_connection_ssl = websocket_connection<beast::ssl_stream<beast::tcp_stream>>;
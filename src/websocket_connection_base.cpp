@@ -1,10 +1,13 @@
 #include "websocket_connection_base.h"
+#include <algorithm>
+#include <cmath>
 
 websocket_connection_base::websocket_connection_base(std::string address, std::string endpoint, uint16_t port)
 {
     this->address = address;
     this->endpoint = endpoint;
     this->port = port;
+    this->reconnect_rng.seed(std::random_device()());
 }
 
 void websocket_connection_base::set_write_callback(std::function<void(size_t)> callback)
@@ -15,6 +18,18 @@ void websocket_connection_base::set_write_callback(std::function<void(size_t)> c
 void websocket_connection_base::set_read_callback(std::function<void(uint8_t *, size_t)> callback)
 {
     this->read_callback = std::make_unique<std::function<void(uint8_t *, size_t)>>(callback);
+    this->stream_reads = false;
+}
+
+void websocket_connection_base::set_fragment_callback(std::function<void(uint8_t *, size_t, bool)> callback)
+{
+    this->fragment_callback = std::make_unique<std::function<void(uint8_t *, size_t, bool)>>(callback);
+    this->stream_reads = true;
+}
+
+void websocket_connection_base::set_read_message_max(int64_t size)
+{
+    this->read_message_max = size;
 }
 
 void websocket_connection_base::set_connect_callback(std::function<void()> callback)
@@ -33,22 +48,411 @@ void websocket_connection_base::set_header(std::string header, std::string value
     this->headers.insert_or_assign(header, value);
 }
 
+void websocket_connection_base::add_subprotocol(std::string protocol)
+{
+    std::lock_guard<std::mutex> guard(this->header_mutex);
+    this->subprotocols.push_back(std::move(protocol));
+}
+
+bool websocket_connection_base::get_protocol(std::string &protocol)
+{
+    return this->get_response_header("Sec-WebSocket-Protocol", protocol);
+}
+
+bool websocket_connection_base::get_response_header(const std::string &name, std::string &value)
+{
+    std::lock_guard<std::mutex> guard(this->response_mutex);
+    auto it = this->handshake_response.find(name);
+    if (it == this->handshake_response.end())
+    {
+        return false;
+    }
+
+    value = std::string(it->value());
+    return true;
+}
+
+bool websocket_connection_base::accept_response(websocket::response_type response)
+{
+    // A server may only pick one of the protocols we offered, RFC 6455 4.1.
+    auto it = response.find(beast::http::field::sec_websocket_protocol);
+    if (it != response.end())
+    {
+        std::lock_guard<std::mutex> guard(this->header_mutex);
+        if (std::find(this->subprotocols.begin(), this->subprotocols.end(), std::string(it->value())) == this->subprotocols.end())
+        {
+            g_RipExt.LogError("WebSocket %s:%d server selected unrequested subprotocol %s", this->address.c_str(), this->port, std::string(it->value()).c_str());
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(this->response_mutex);
+    this->handshake_response = std::move(response);
+    return true;
+}
+
+void websocket_connection_base::set_handshake_timeout(std::chrono::milliseconds timeout)
+{
+    this->handshake_timeout_ms = timeout.count();
+}
+
+void websocket_connection_base::set_connect_timeout(std::chrono::milliseconds timeout)
+{
+    this->connect_timeout_ms = timeout.count();
+}
+
+void websocket_connection_base::set_reconnect_policy(websocket_reconnect_policy policy)
+{
+    std::lock_guard<std::mutex> guard(this->reconnect_mutex);
+    this->reconnect_policy = policy;
+}
+
+bool websocket_connection_base::next_reconnect_delay(std::chrono::milliseconds &delay)
+{
+    std::lock_guard<std::mutex> guard(this->reconnect_mutex);
+    const auto &policy = this->reconnect_policy;
+    if (policy.base_delay.count() <= 0)
+    {
+        return false;
+    }
+
+    if (policy.max_attempts > 0 && this->reconnect_attempts >= policy.max_attempts)
+    {
+        return false;
+    }
+
+    // Exponential backoff capped at max_delay, then shortened by a random fraction of up to
+    // `jitter` so that servers which lost the backend at the same time don't retry in lockstep.
+    double backoff = static_cast<double>(policy.base_delay.count()) * std::pow(2.0, this->reconnect_attempts);
+    backoff = std::min(backoff, static_cast<double>(std::max(policy.max_delay, policy.base_delay).count()));
+
+    std::uniform_real_distribution<double> spread(0.0, policy.jitter);
+    backoff *= 1.0 - spread(this->reconnect_rng);
+
+    delay = std::chrono::milliseconds(std::llround(backoff));
+    this->reconnect_attempts++;
+    return true;
+}
+
+void websocket_connection_base::reset_reconnect()
+{
+    std::lock_guard<std::mutex> guard(this->reconnect_mutex);
+    this->reconnect_attempts = 0;
+}
+
+void websocket_connection_base::queue_message(std::string data, bool binary)
+{
+    if (!this->ws_connect)
+    {
+        size_t limit;
+        {
+            std::lock_guard<std::mutex> guard(this->reconnect_mutex);
+            limit = this->reconnect_policy.max_buffered_bytes;
+        }
+
+        if (data.size() > limit)
+        {
+            g_RipExt.LogError("WebSocket %s:%d is not connected, dropping %zu byte message", this->address.c_str(), this->port, data.size());
+            return;
+        }
+
+        // Keep the newest messages when the outage buffer is full. A write that is
+        // still in flight owns the front entry until on_write, so it is never evicted.
+        size_t first = this->write_in_progress ? 1 : 0;
+        size_t dropped = 0;
+        while (this->queued_bytes + data.size() > limit && this->write_queue.size() > first)
+        {
+            this->remove_message(first);
+            dropped++;
+        }
+
+        if (dropped > 0)
+        {
+            g_RipExt.LogError("WebSocket %s:%d write buffer is full, dropped %zu queued messages", this->address.c_str(), this->port, dropped);
+        }
+    }
+
+    this->queued_bytes += data.size();
+    this->queued_messages++;
+    this->write_queue.push_back(websocket_message{std::move(data), binary});
+}
+
+void websocket_connection_base::pop_message()
+{
+    if (this->write_queue.empty())
+    {
+        return;
+    }
+    this->remove_message(0);
+}
+
+void websocket_connection_base::remove_message(size_t index)
+{
+    auto it = this->write_queue.begin() + index;
+    this->queued_bytes -= it->data.size();
+    this->queued_messages--;
+    this->release_buffer(std::move(it->data));
+    this->write_queue.erase(it);
+}
+
+void websocket_connection_base::clear_write_queue()
+{
+    // The front entry of a write in flight is popped by on_write once it completes.
+    size_t keep = this->write_in_progress ? 1 : 0;
+    while (this->write_queue.size() > keep)
+    {
+        this->remove_message(this->write_queue.size() - 1);
+    }
+}
+
+std::string websocket_connection_base::acquire_buffer()
+{
+    std::lock_guard<std::mutex> guard(this->buffer_pool_mutex);
+    if (this->buffer_pool.empty())
+    {
+        return std::string();
+    }
+
+    std::string buffer = std::move(this->buffer_pool.back());
+    this->buffer_pool.pop_back();
+    this->pooled_bytes -= buffer.capacity();
+    return buffer;
+}
+
+void websocket_connection_base::release_buffer(std::string buffer)
+{
+    if (buffer.capacity() == 0 || buffer.capacity() > WEBSOCKET_BUFFER_POOL_MAX_CAPACITY)
+    {
+        return;
+    }
+
+    buffer.clear();
+    std::lock_guard<std::mutex> guard(this->buffer_pool_mutex);
+    if (this->buffer_pool.size() < WEBSOCKET_BUFFER_POOL_SIZE)
+    {
+        this->pooled_bytes += buffer.capacity();
+        this->buffer_pool.push_back(std::move(buffer));
+    }
+}
+
+void websocket_connection_base::record_read(size_t bytes, bool message_done)
+{
+    this->bytes_in += bytes;
+    if (message_done)
+    {
+        this->messages_in++;
+    }
+    this->read_buffer_bytes = this->buffer.capacity();
+}
+
+void websocket_connection_base::set_inbound_budget(size_t max_messages, size_t max_bytes)
+{
+    this->inbound_max_messages = max_messages;
+    this->inbound_max_bytes = max_bytes;
+    if (this->reads_paused && !this->over_inbound_budget())
+    {
+        this->resume_reads();
+    }
+}
+
+void websocket_connection_base::inbound_acquire(size_t bytes)
+{
+    this->inbound_messages++;
+    this->inbound_bytes += bytes;
+}
+
+void websocket_connection_base::inbound_release(size_t bytes)
+{
+    this->inbound_messages--;
+    this->inbound_bytes -= bytes;
+    if (this->reads_paused && !this->over_inbound_budget())
+    {
+        this->resume_reads();
+    }
+}
+
+bool websocket_connection_base::over_inbound_budget()
+{
+    size_t max_messages = this->inbound_max_messages;
+    size_t max_bytes = this->inbound_max_bytes;
+    return (max_messages > 0 && this->inbound_messages >= max_messages) || (max_bytes > 0 && this->inbound_bytes >= max_bytes);
+}
+
+void websocket_connection_base::record_write(size_t bytes)
+{
+    this->bytes_out += bytes;
+    this->messages_out++;
+}
+
+void websocket_connection_base::start_handshake_clock()
+{
+    this->handshake_started = std::chrono::steady_clock::now();
+}
+
+void websocket_connection_base::stop_handshake_clock()
+{
+    // Covers resolve, connect, TLS and the upgrade, or just the upgrade for accepted sessions.
+    auto elapsed = std::chrono::steady_clock::now() - this->handshake_started;
+    this->handshake_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+websocket_stats websocket_connection_base::get_stats()
+{
+    websocket_stats stats;
+    stats.bytes_in = this->bytes_in;
+    stats.bytes_out = this->bytes_out;
+    stats.messages_in = this->messages_in;
+    stats.messages_out = this->messages_out;
+    stats.queued_messages = this->queued_messages;
+    stats.queued_bytes = this->queued_bytes;
+    stats.inbound_messages = this->inbound_messages;
+    stats.inbound_bytes = this->inbound_bytes;
+    stats.reconnects = this->reconnects;
+    stats.handshake_us = this->handshake_us;
+    return stats;
+}
+
+size_t websocket_connection_base::approx_size()
+{
+    return sizeof(websocket_connection_base) + this->queued_bytes + this->pooled_bytes + this->read_buffer_bytes + this->inbound_bytes;
+}
+
+static int websocket_dump_callback(const char *buffer, size_t size, void *data)
+{
+    reinterpret_cast<std::string *>(data)->append(buffer, size);
+    return 0;
+}
+
+bool websocket_connection_base::serialize_json(json_t *object, size_t flags, std::string &out)
+{
+    out = this->acquire_buffer();
+    if (json_dump_callback(object, websocket_dump_callback, &out, flags) != 0)
+    {
+        this->release_buffer(std::move(out));
+        return false;
+    }
+
+    return true;
+}
+
+void websocket_connection_base::set_idle_timeout(std::chrono::milliseconds timeout)
+{
+    this->idle_timeout_ms = timeout.count();
+}
+
+void websocket_connection_base::set_ping_interval(std::chrono::milliseconds interval)
+{
+    this->ping_interval_ms = interval.count();
+}
+
+double websocket_connection_base::get_latency()
+{
+    int64_t latency = this->latency_us;
+    return latency < 0 ? -1.0 : latency / 1000.0;
+}
+
+void websocket_connection_base::configure_timeout(websocket::stream_base::timeout &timeout)
+{
+    timeout = websocket::stream_base::timeout::suggested(this->server_role ? beast::role_type::server : beast::role_type::client);
+    timeout.keep_alive_pings = true;
+
+    int64_t handshake = this->handshake_timeout_ms;
+    if (handshake == 0)
+    {
+        timeout.handshake_timeout = websocket::stream_base::none();
+    }
+    else if (handshake > 0)
+    {
+        timeout.handshake_timeout = std::chrono::milliseconds(handshake);
+    }
+
+    int64_t idle = this->idle_timeout_ms;
+    if (idle == 0)
+    {
+        timeout.idle_timeout = websocket::stream_base::none();
+    }
+    else if (idle > 0)
+    {
+        timeout.idle_timeout = std::chrono::milliseconds(idle);
+    }
+}
+
+std::string websocket_connection_base::make_ping_payload()
+{
+    // The send time travels in the ping payload and comes back in the pong,
+    // so no per-ping state is needed to compute the round trip.
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    return std::to_string(now.count());
+}
+
+void websocket_connection_base::on_control(websocket::frame_type kind, beast::string_view payload)
+{
+    if (kind != websocket::frame_type::pong || payload.empty())
+    {
+        return;
+    }
+
+    // Keep-alive pings sent by beast itself carry no payload and are ignored above.
+    char *end;
+    std::string sent(payload.data(), payload.size());
+    long long sent_us = std::strtoll(sent.c_str(), &end, 10);
+    if (*end != '\0')
+    {
+        return;
+    }
+
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    if (now.count() >= sent_us)
+    {
+        this->latency_us = now.count() - sent_us;
+    }
+}
+
 void websocket_connection_base::add_headers(websocket::request_type &req)
 {
     req.set(beast::http::field::user_agent, std::string(BOOST_BEAST_VERSION_STRING) + " SourceMod-WebSockets v" + SMEXT_CONF_VERSION);
     std::lock_guard<std::mutex> guard(this->header_mutex);
+    if (!this->subprotocols.empty())
+    {
+        std::string protocols;
+        for (const auto &protocol : this->subprotocols)
+        {
+            if (!protocols.empty())
+            {
+                protocols.append(", ");
+            }
+            protocols.append(protocol);
+        }
+        req.set(beast::http::field::sec_websocket_protocol, protocols);
+    }
+
     for (std::pair<std::string, std::string> elem : this->headers)
     {
         req.set(elem.first, elem.second);
     }
 }
 
+void websocket_connection_base::add_response_headers(websocket::response_type &res)
+{
+    res.set(beast::http::field::server, std::string(BOOST_BEAST_VERSION_STRING) + " SourceMod-WebSockets v" + SMEXT_CONF_VERSION);
+}
+
+std::string websocket_connection_base::get_address()
+{
+    return this->address;
+}
+
 void websocket_connection_base::destroy()
 {
     this->pending_delete = true;
     this->close();
 }
 
+bool websocket_connection_base::destroyed()
+{
+    return this->pending_delete;
+}
+
 bool websocket_connection_base::ws_open()
 {
     return this->ws_connect;
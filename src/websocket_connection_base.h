@@ -6,6 +6,11 @@
 #include <memory>
 #include "extension.h"
 #include <map>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <vector>
 
 #if defined WIN32
 #include <sdkddkver.h>
@@ -15,35 +20,165 @@ namespace websocket = boost::beast::websocket;
 namespace beast = boost::beast;
 using tcp = boost::asio::ip::tcp;
 
-class websocket_connection_base
+struct websocket_message
+{
+    std::string data;
+    bool binary;
+};
+
+// Upper bound for a single async_read_some when fragments are streamed to the plugin.
+#define WEBSOCKET_READ_CHUNK_SIZE 65536
+
+// Serialized messages are written into recycled strings, buffers that grew past the
+// capacity limit are released instead of pinning that memory in the pool.
+#define WEBSOCKET_BUFFER_POOL_SIZE 16
+#define WEBSOCKET_BUFFER_POOL_MAX_CAPACITY 65536
+
+struct websocket_reconnect_policy
+{
+    std::chrono::milliseconds base_delay{0};
+    std::chrono::milliseconds max_delay{0};
+    double jitter = 0.0;
+    int max_attempts = 0;
+    size_t max_buffered_bytes = 0;
+};
+
+struct websocket_stats
+{
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t messages_in;
+    uint64_t messages_out;
+    size_t queued_messages;
+    size_t queued_bytes;
+    size_t inbound_messages;
+    size_t inbound_bytes;
+    int64_t reconnects;
+    int64_t handshake_us;
+};
+
+// Connections are always owned by a shared_ptr: the event loop registry holds one reference
+// and every pending handler holds another, so the object outlives its last callback.
+class websocket_connection_base : public std::enable_shared_from_this<websocket_connection_base>
 {
 public:
     websocket_connection_base(std::string address, std::string endpoint, uint16_t port);
+    virtual ~websocket_connection_base() = default;
     void set_write_callback(std::function<void(std::size_t)> callback);
     void set_read_callback(std::function<void(uint8_t *, std::size_t)> callback);
+    void set_fragment_callback(std::function<void(uint8_t *, std::size_t, bool)> callback);
+    void set_read_message_max(int64_t size);
     void set_connect_callback(std::function<void()> callback);
     void set_disconnect_callback(std::function<void()> callback);
     void set_header(std::string key, std::string value);
+    void add_subprotocol(std::string protocol);
+    bool get_protocol(std::string &protocol);
+    bool get_response_header(const std::string &name, std::string &value);
+    void set_handshake_timeout(std::chrono::milliseconds timeout);
+    void set_connect_timeout(std::chrono::milliseconds timeout);
+    void set_reconnect_policy(websocket_reconnect_policy policy);
+    void set_idle_timeout(std::chrono::milliseconds timeout);
+    void set_ping_interval(std::chrono::milliseconds interval);
+    void set_inbound_budget(size_t max_messages, size_t max_bytes);
+    // Called on the game thread once a delivered message has been handed to the plugin.
+    void inbound_release(size_t bytes);
+    double get_latency();
     void add_headers(websocket::request_type &req);
+    static void add_response_headers(websocket::response_type &res);
+    std::string get_address();
     void destroy();
+    bool destroyed();
     bool ws_open();
+    bool serialize_json(json_t *object, size_t flags, std::string &out);
+    websocket_stats get_stats();
+    // Object size plus everything it currently buffers, reported to the handle system.
+    virtual size_t approx_size();
 
     virtual void close() = 0;
     virtual void connect() = 0;
-    virtual void write(boost::asio::const_buffer buffer) = 0;
+    virtual void write(std::string data, bool binary) = 0;
+    // Takes over the reference to object and serializes it on the network thread.
+    virtual void write_json(json_t *object, size_t flags) = 0;
     virtual bool socket_open() = 0;
 
 protected:
+    virtual void resume_reads() = 0;
+
+protected:
+    bool next_reconnect_delay(std::chrono::milliseconds &delay);
+    void reset_reconnect();
+    void queue_message(std::string data, bool binary);
+    void pop_message();
+    void remove_message(size_t index);
+    void clear_write_queue();
+    std::string acquire_buffer();
+    void release_buffer(std::string buffer);
+    void configure_timeout(websocket::stream_base::timeout &timeout);
+    std::string make_ping_payload();
+    void on_control(websocket::frame_type kind, beast::string_view payload);
+    bool accept_response(websocket::response_type response);
+    void record_read(size_t bytes, bool message_done);
+    void inbound_acquire(size_t bytes);
+    bool over_inbound_budget();
+    void record_write(size_t bytes);
+    void start_handshake_clock();
+    void stop_handshake_clock();
+
     std::unique_ptr<std::function<void(uint8_t *, std::size_t)>> read_callback;
+    std::unique_ptr<std::function<void(uint8_t *, std::size_t, bool)>> fragment_callback;
+    std::atomic<bool> stream_reads{false};
+    bool reading_fragments = false;
+    std::atomic<int64_t> read_message_max{-1};
     std::unique_ptr<std::function<void(std::size_t)>> write_callback;
     std::unique_ptr<std::function<void()>> connect_callback;
     std::unique_ptr<std::function<void()>> disconnect_callback;
     std::map<std::string, std::string> headers;
+    std::vector<std::string> subprotocols;
     std::mutex header_mutex;
+    websocket::response_type handshake_response;
+    std::mutex response_mutex;
+    std::atomic<int64_t> handshake_timeout_ms{-1};
+    std::atomic<int64_t> connect_timeout_ms{30000};
+    std::deque<websocket_message> write_queue;
+    std::atomic<size_t> queued_bytes{0};
+    std::atomic<size_t> queued_messages{0};
+    bool write_in_progress = false;
+    std::vector<std::string> buffer_pool;
+    std::atomic<size_t> pooled_bytes{0};
+    std::mutex buffer_pool_mutex;
+    websocket_reconnect_policy reconnect_policy;
+    std::mutex reconnect_mutex;
+    std::mt19937 reconnect_rng;
+    int reconnect_attempts = 0;
+    bool user_closed = false;
+    std::atomic<int64_t> idle_timeout_ms{-1};
+    std::atomic<int64_t> ping_interval_ms{0};
+    std::atomic<int64_t> latency_us{-1};
+    bool ping_in_progress = false;
     beast::flat_buffer buffer;
+    std::atomic<size_t> read_buffer_bytes{0};
+
+    // Deliveries waiting for the game thread. Past the budget no read is armed, so the
+    // kernel buffers fill up and TCP flow control throttles the peer. 0 means no limit.
+    std::atomic<size_t> inbound_messages{0};
+    std::atomic<size_t> inbound_bytes{0};
+    std::atomic<size_t> inbound_max_messages{0};
+    std::atomic<size_t> inbound_max_bytes{0};
+    std::atomic<bool> reads_paused{false};
+
+    // Counters are written on the strand and read from the game thread.
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> messages_in{0};
+    std::atomic<uint64_t> messages_out{0};
+    std::atomic<int64_t> reconnects{0};
+    std::atomic<int64_t> handshake_us{-1};
+    std::chrono::steady_clock::time_point handshake_started;
     std::string address;
     std::string endpoint;
     uint16_t port;
-    bool pending_delete = false;
-    bool ws_connect = false;
+    // Set for sessions accepted by a websocket_server, these never dial out or reconnect.
+    bool server_role = false;
+    std::atomic<bool> pending_delete{false};
+    std::atomic<bool> ws_connect{false};
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "websocket_dns_cache.h"
+
+constexpr std::chrono::seconds websocket_dns_cache::positive_ttl;
+constexpr std::chrono::seconds websocket_dns_cache::negative_ttl;
+constexpr size_t websocket_dns_cache::max_in_flight;
+constexpr size_t websocket_dns_cache::max_entries;
+
+websocket_dns_cache::websocket_dns_cache(boost::asio::io_context &context)
+    : strand(boost::asio::make_strand(context)), resolver(strand)
+{
+}
+
+void websocket_dns_cache::async_resolve(const std::string &host, uint16_t port, handler_type handler)
+{
+    boost::asio::post(this->strand, [this, host, port, handler = std::move(handler)]() mutable
+                      {
+        std::string s_port = std::to_string(port);
+        std::string key = host + ":" + s_port;
+        auto now = std::chrono::steady_clock::now();
+
+        auto cached = this->cache.find(key);
+        if (cached != this->cache.end())
+        {
+            if (cached->second.expires > now)
+            {
+                handler(cached->second.ec, cached->second.results);
+                return;
+            }
+            this->cache.erase(cached);
+        }
+
+        auto &query = this->lookups[key];
+        query.waiters.push_back(std::move(handler));
+        if (query.waiters.size() == 1)
+        {
+            query.host = host;
+            query.port = s_port;
+            this->pending.push_back(key);
+            this->start_pending();
+        } });
+}
+
+void websocket_dns_cache::start_pending()
+{
+    while (this->in_flight < max_in_flight && !this->pending.empty())
+    {
+        std::string key = std::move(this->pending.front());
+        this->pending.pop_front();
+
+        auto &query = this->lookups[key];
+        this->in_flight++;
+        this->resolver.async_resolve(query.host, query.port, beast::bind_front_handler(&websocket_dns_cache::on_resolve, this, key));
+    }
+}
+
+void websocket_dns_cache::on_resolve(std::string key, beast::error_code ec, results_type results)
+{
+    this->in_flight--;
+
+    auto now = std::chrono::steady_clock::now();
+    if (ec != boost::asio::error::operation_aborted)
+    {
+        this->prune(now);
+        // Failures are cached briefly too, so a dead hostname isn't queried once per socket.
+        this->cache[key] = entry{ec, results, now + (ec ? std::chrono::steady_clock::duration(negative_ttl) : std::chrono::steady_clock::duration(positive_ttl))};
+    }
+
+    std::vector<handler_type> waiters = std::move(this->lookups[key].waiters);
+    this->lookups.erase(key);
+
+    this->start_pending();
+
+    for (auto &waiter : waiters)
+    {
+        waiter(ec, results);
+    }
+}
+
+void websocket_dns_cache::prune(std::chrono::steady_clock::time_point now)
+{
+    for (auto it = this->cache.begin(); it != this->cache.end();)
+    {
+        if (it->second.expires <= now)
+        {
+            it = this->cache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    while (this->cache.size() >= max_entries)
+    {
+        auto oldest = this->cache.begin();
+        for (auto it = this->cache.begin(); it != this->cache.end(); ++it)
+        {
+            if (it->second.expires < oldest->second.expires)
+            {
+                oldest = it;
+            }
+        }
+        this->cache.erase(oldest);
+    }
+}
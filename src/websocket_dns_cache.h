@@ -0,0 +1,59 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace beast = boost::beast;
+using tcp = boost::asio::ip::tcp;
+
+// Process-wide resolver shared by all WebSocket connections. Lookups are cached per
+// host:port, concurrent lookups for the same key are coalesced into one query and the
+// number of queries in flight is capped, so a reconnect storm costs a single lookup.
+class websocket_dns_cache
+{
+public:
+    using results_type = tcp::resolver::results_type;
+    using handler_type = std::function<void(beast::error_code, results_type)>;
+
+    explicit websocket_dns_cache(boost::asio::io_context &context);
+
+    // The handler is invoked on the cache's strand, callers have to post back to their own.
+    void async_resolve(const std::string &host, uint16_t port, handler_type handler);
+
+    static constexpr std::chrono::seconds positive_ttl{60};
+    static constexpr std::chrono::seconds negative_ttl{5};
+    static constexpr size_t max_in_flight = 4;
+    static constexpr size_t max_entries = 256;
+
+private:
+    struct entry
+    {
+        beast::error_code ec;
+        results_type results;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct lookup
+    {
+        std::string host;
+        std::string port;
+        std::vector<handler_type> waiters;
+    };
+
+    void start_pending();
+    void on_resolve(std::string key, beast::error_code ec, results_type results);
+    void prune(std::chrono::steady_clock::time_point now);
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand;
+    tcp::resolver resolver;
+    std::map<std::string, entry> cache;
+    std::map<std::string, lookup> lookups;
+    std::deque<std::string> pending;
+    size_t in_flight = 0;
+};
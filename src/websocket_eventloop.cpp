@@ -1,6 +1,11 @@
 #include "websocket_eventloop.h"
+#include "websocket_connection_base.h"
+#include "websocket_server.h"
 #include <thread>
 
+// How long unload waits for open connections to finish their close handshake.
+#define WEBSOCKET_DRAIN_TIMEOUT std::chrono::milliseconds(2000)
+
 websocket_eventloop event_loop;
 
 void ev_run()
@@ -8,15 +13,203 @@ void ev_run()
     event_loop.run();
 }
 
+static int on_new_tls_session(SSL *ssl, SSL_SESSION *session)
+{
+    const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (host == nullptr)
+    {
+        return 0;
+    }
+
+    // Returning 1 keeps the reference OpenSSL handed us.
+    event_loop.store_tls_session(host, session);
+    return 1;
+}
+
 void websocket_eventloop::OnExtLoad()
 {
-    std::thread(ev_run).detach();
+    this->configure_ssl_context();
+    this->thread = std::thread(ev_run);
 }
 
 void websocket_eventloop::OnExtUnload()
 {
+    this->drain_connections(WEBSOCKET_DRAIN_TIMEOUT);
+
+    // Join the loop thread before anything is torn down, no handler may run past this point.
     this->context.stop();
-    this->context.reset();
+    if (this->thread.joinable())
+    {
+        this->thread.join();
+    }
+
+    // Connections that missed the deadline still own sockets on this context, release them
+    // before the context is restarted so their destructors do not touch a running loop.
+    std::unordered_map<websocket_connection_base *, std::shared_ptr<websocket_connection_base>> leftover;
+    std::unordered_map<websocket_server *, std::shared_ptr<websocket_server>> leftover_servers;
+    {
+        std::lock_guard<std::mutex> guard(this->connection_mutex);
+        leftover.swap(this->connections);
+        leftover_servers.swap(this->servers);
+    }
+    leftover.clear();
+    leftover_servers.clear();
+
+    this->context.restart();
+    this->clear_tls_sessions();
+}
+
+void websocket_eventloop::drain_connections(std::chrono::milliseconds deadline)
+{
+    // Stop accepting first so no new sessions show up while draining.
+    std::vector<std::shared_ptr<websocket_server>> listeners;
+    std::vector<std::shared_ptr<websocket_connection_base>> live;
+    {
+        std::lock_guard<std::mutex> guard(this->connection_mutex);
+        for (auto &elem : this->servers)
+        {
+            listeners.push_back(elem.second);
+        }
+        for (auto &elem : this->connections)
+        {
+            live.push_back(elem.second);
+        }
+    }
+
+    for (auto &server : listeners)
+    {
+        server->destroy();
+    }
+    listeners.clear();
+
+    for (auto &connection : live)
+    {
+        if (!connection->destroyed())
+        {
+            connection->destroy();
+        }
+    }
+    live.clear();
+
+    std::unique_lock<std::mutex> lock(this->connection_mutex);
+    if (!this->connection_cv.wait_for(lock, deadline, [this]
+                                      { return this->connections.empty(); }))
+    {
+        g_RipExt.LogError("%d WebSocket connection(s) did not close in time", static_cast<int>(this->connections.size()));
+    }
+}
+
+void websocket_eventloop::add_connection(std::shared_ptr<websocket_connection_base> connection)
+{
+    std::lock_guard<std::mutex> guard(this->connection_mutex);
+    auto key = connection.get();
+    this->connections.emplace(key, std::move(connection));
+}
+
+void websocket_eventloop::add_server(std::shared_ptr<websocket_server> server)
+{
+    std::lock_guard<std::mutex> guard(this->connection_mutex);
+    auto key = server.get();
+    this->servers.emplace(key, std::move(server));
+}
+
+void websocket_eventloop::remove_server(websocket_server *server)
+{
+    std::shared_ptr<websocket_server> released;
+    std::lock_guard<std::mutex> guard(this->connection_mutex);
+    auto it = this->servers.find(server);
+    if (it != this->servers.end())
+    {
+        released = std::move(it->second);
+        this->servers.erase(it);
+    }
+}
+
+void websocket_eventloop::remove_connection(websocket_connection_base *connection)
+{
+    std::shared_ptr<websocket_connection_base> released;
+    {
+        std::lock_guard<std::mutex> guard(this->connection_mutex);
+        auto it = this->connections.find(connection);
+        if (it == this->connections.end())
+        {
+            return;
+        }
+        released = std::move(it->second);
+        this->connections.erase(it);
+    }
+    this->connection_cv.notify_all();
+}
+
+void websocket_eventloop::configure_ssl_context()
+{
+    SSL_CTX *ctx = this->ssl_ctx.native_handle();
+
+    // TLS 1.2 and 1.3 only.
+    this->ssl_ctx.set_options(boost::asio::ssl::context::default_workarounds | boost::asio::ssl::context::no_sslv2 | boost::asio::ssl::context::no_sslv3 | boost::asio::ssl::context::no_tlsv1 | boost::asio::ssl::context::no_tlsv1_1);
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+    // Trust the same CA store as the HTTP natives, falling back to the system store.
+    this->ssl_ctx.set_verify_mode(boost::asio::ssl::verify_peer);
+    this->ssl_ctx.set_default_verify_paths();
+    beast::error_code ec;
+    this->ssl_ctx.load_verify_file(g_RipExt.caBundlePath, ec);
+    if (ec)
+    {
+        g_RipExt.LogError("Could not load CA bundle %s for WebSockets: %s", g_RipExt.caBundlePath, ec.message().c_str());
+    }
+
+    // The WebSocket upgrade always runs over HTTP/1.1.
+    static const unsigned char alpn[] = {8, 'h', 't', 't', 'p', '/', '1', '.', '1'};
+    SSL_CTX_set_alpn_protos(ctx, alpn, sizeof(alpn));
+
+    // Client sessions are kept per host by us, OpenSSL only reports them through the callback.
+    // This also catches TLS 1.3 tickets, which arrive after the handshake completed.
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, on_new_tls_session);
+}
+
+void websocket_eventloop::resume_tls_session(SSL *ssl, const std::string &host)
+{
+    std::lock_guard<std::mutex> guard(this->tls_session_mutex);
+    auto it = this->tls_sessions.find(host);
+    if (it == this->tls_sessions.end())
+    {
+        return;
+    }
+
+    if (!SSL_SESSION_is_resumable(it->second))
+    {
+        SSL_SESSION_free(it->second);
+        this->tls_sessions.erase(it);
+        return;
+    }
+
+    SSL_set_session(ssl, it->second);
+}
+
+void websocket_eventloop::store_tls_session(const std::string &host, SSL_SESSION *session)
+{
+    std::lock_guard<std::mutex> guard(this->tls_session_mutex);
+    auto it = this->tls_sessions.find(host);
+    if (it != this->tls_sessions.end())
+    {
+        SSL_SESSION_free(it->second);
+        it->second = session;
+        return;
+    }
+
+    this->tls_sessions.emplace(host, session);
+}
+
+void websocket_eventloop::clear_tls_sessions()
+{
+    std::lock_guard<std::mutex> guard(this->tls_session_mutex);
+    for (auto &elem : this->tls_sessions)
+    {
+        SSL_SESSION_free(elem.second);
+    }
+    this->tls_sessions.clear();
 }
 
 void websocket_eventloop::run()
@@ -33,3 +226,8 @@ boost::asio::ssl::context &websocket_eventloop::get_ssl_context()
 {
     return this->ssl_ctx;
 }
+
+websocket_dns_cache &websocket_eventloop::get_dns_cache()
+{
+    return this->dns_cache;
+}
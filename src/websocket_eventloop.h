@@ -2,6 +2,18 @@
 #include "extension.h"
 #include <boost/beast/core.hpp>
 #include <boost/beast/ssl.hpp>
+#include <chrono>
+#include <condition_variable>
+#include "websocket_dns_cache.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+class websocket_connection_base;
+class websocket_server;
 
 class websocket_eventloop
 {
@@ -12,17 +24,39 @@ public:
 
     boost::asio::io_context &get_context();
     boost::asio::ssl::context &get_ssl_context();
+    websocket_dns_cache &get_dns_cache();
+
+    void add_connection(std::shared_ptr<websocket_connection_base> connection);
+    void remove_connection(websocket_connection_base *connection);
+    void add_server(std::shared_ptr<websocket_server> server);
+    void remove_server(websocket_server *server);
+
+    void resume_tls_session(SSL *ssl, const std::string &host);
+    void store_tls_session(const std::string &host, SSL_SESSION *session);
 
-    websocket_eventloop() : work(context), ssl_ctx(boost::asio::ssl::context::tlsv12_client)
+    websocket_eventloop() : work(context.get_executor()), ssl_ctx(boost::asio::ssl::context::tls_client), dns_cache(context)
     {
-        this->ssl_ctx.set_verify_mode(boost::asio::ssl::verify_peer);
-        this->ssl_ctx.set_default_verify_paths();
     }
 
 private:
+    void configure_ssl_context();
+    void clear_tls_sessions();
+    void drain_connections(std::chrono::milliseconds deadline);
+
+    std::map<std::string, SSL_SESSION *> tls_sessions;
+    std::mutex tls_session_mutex;
+
+    // Live connections keyed by the pointer stored in their handle.
+    std::unordered_map<websocket_connection_base *, std::shared_ptr<websocket_connection_base>> connections;
+    std::unordered_map<websocket_server *, std::shared_ptr<websocket_server>> servers;
+    std::mutex connection_mutex;
+    std::condition_variable connection_cv;
+
     boost::asio::io_context context;
-    boost::asio::io_context::work work;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+    std::thread thread;
     boost::asio::ssl::context ssl_ctx;
+    websocket_dns_cache dns_cache;
 };
 
 extern websocket_eventloop event_loop;
\ No newline at end of file
@@ -1,12 +1,19 @@
 #include "websocket_connection_base.h"
-#include "websocket_connection_ssl.h"
 #include "websocket_connection.h"
+#include "websocket_eventloop.h"
+#include "websocket_server.h"
+#include "json_lines.h"
+#include "json_view.h"
 #include "url.hpp"
 
 enum
 {
     WebSocket_JSON,
     Websocket_STRING,
+    WebSocket_BINARY,
+    WebSocket_FRAGMENT,
+    WebSocket_JSONVIEW,
+    WebSocket_NDJSON,
 };
 
 HandleError websocket_read_handle(Handle_t hndl, IPluginContext *p_context, websocket_connection_base **obj)
@@ -25,6 +32,34 @@ HandleError websocket_read_handle(Handle_t hndl, IPluginContext *p_context, webs
     return HandleError_None;
 }
 
+HandleError websocket_server_read_handle(Handle_t hndl, IPluginContext *p_context, websocket_server **obj)
+{
+    HandleSecurity sec;
+
+    sec.pOwner = p_context->GetIdentity();
+    sec.pIdentity = myself->GetIdentity();
+    HandleError herr;
+    if ((herr = handlesys->ReadHandle(hndl, htWebSocketServer, &sec, reinterpret_cast<void **>(obj))) != HandleError_None)
+    {
+        p_context->ReportError("Invalid WebSocketServer handle (error %d)", herr);
+        return herr;
+    }
+
+    return HandleError_None;
+}
+
+// Callbacks are deferred to the game thread, by then the handle may already be closed
+// and the plugin that owned the callback unloaded.
+static std::shared_ptr<websocket_connection_base> websocket_lock(const std::weak_ptr<websocket_connection_base> &weak)
+{
+    auto connection = weak.lock();
+    if (connection && connection->destroyed())
+    {
+        return nullptr;
+    }
+    return connection;
+}
+
 static json_t *GetJSONFromHandle(IPluginContext *pContext, Handle_t hndl)
 {
     HandleError err;
@@ -82,13 +117,128 @@ static cell_t native_SetReadCallback(IPluginContext *p_context, const cell_t *pa
     }
 
     cell_t data = params[4];
+    std::weak_ptr<websocket_connection_base> weak = connection->shared_from_this();
+
+    if (callback_type == WebSocket_FRAGMENT)
+    {
+        connection->set_fragment_callback([weak, callback, hndl_websocket, data](auto buffer, auto size, auto final)
+                                          {
+            std::string fragment(reinterpret_cast<const char*>(buffer), size);
+            free(buffer);
+
+            g_RipExt.Defer([weak, callback, hndl_websocket, fragment, data, final]() {
+                auto connection = websocket_lock(weak);
+                if (!connection)
+                {
+                    return;
+                }
+
+                callback->PushCell(hndl_websocket);
+                callback->PushStringEx(const_cast<char *>(fragment.data()), fragment.size(), SM_PARAM_STRING_COPY | SM_PARAM_STRING_BINARY, 0);
+                callback->PushCell(fragment.size());
+                callback->PushCell(final);
+                callback->PushCell(data);
+                callback->Execute(nullptr);
+                connection->inbound_release(fragment.size());
+            }); });
+        return 1;
+    }
+
+    if (callback_type == WebSocket_JSONVIEW)
+    {
+        connection->set_read_callback([weak, callback, hndl_websocket, p_context, data](auto buffer, auto size)
+                                      {
+            // Parse on the network thread, the game thread only creates the handle.
+            std::string error;
+            std::shared_ptr<JSONViewDocument> document = JSONViewDocument::Parse(reinterpret_cast<const char*>(buffer), size, error);
+            free(buffer);
+
+            if (!document)
+            {
+                g_RipExt.LogError("WebSocket message is not valid JSON: %s", error.c_str());
+            }
+
+            g_RipExt.Defer([weak, callback, hndl_websocket, document, p_context, data, size]() {
+                auto connection = websocket_lock(weak);
+                if (!connection)
+                {
+                    return;
+                }
+
+                Handle_t handle = BAD_HANDLE;
+                if (document)
+                {
+                    JSONView *view = new JSONView{document, 0};
+                    handle = handlesys->CreateHandle(htJSONView, view, p_context->GetIdentity(), myself->GetIdentity(), nullptr);
+                    if (handle == BAD_HANDLE)
+                    {
+                        delete view;
+                    }
+                }
 
-    connection->set_read_callback([callback, hndl_websocket, p_context, data, callback_type](auto buffer, auto size)
+                callback->PushCell(hndl_websocket);
+                callback->PushCell(handle);
+                callback->PushCell(data);
+                callback->Execute(nullptr);
+                connection->inbound_release(size);
+            }); });
+        return 1;
+    }
+
+    if (callback_type == WebSocket_NDJSON)
+    {
+        connection->set_read_callback([weak, callback, hndl_websocket, p_context, data](auto buffer, auto size)
+                                      {
+            // Each message holds one or more whole records, split and parsed on the network thread.
+            std::vector<json_t *> records;
+            JSONLineParser parser;
+            auto collect = [&records](json_t *record, size_t) { records.push_back(record); };
+            parser.Feed(reinterpret_cast<const char*>(buffer), size, collect);
+            parser.Finish(collect);
+            free(buffer);
+
+            g_RipExt.Defer([weak, callback, hndl_websocket, records, p_context, data, size]() {
+                auto connection = websocket_lock(weak);
+                if (!connection)
+                {
+                    for (json_t *record : records)
+                    {
+                        json_decref(record);
+                    }
+                    return;
+                }
+
+                for (json_t *record : records)
+                {
+                    Handle_t handle = handlesys->CreateHandle(htJSON, record, p_context->GetIdentity(), myself->GetIdentity(), nullptr);
+                    if (handle == BAD_HANDLE)
+                    {
+                        json_decref(record);
+                        continue;
+                    }
+
+                    callback->PushCell(hndl_websocket);
+                    callback->PushCell(handle);
+                    callback->PushCell(data);
+                    callback->Execute(nullptr);
+                }
+                connection->inbound_release(size);
+            }); });
+        return 1;
+    }
+
+    connection->set_read_callback([weak, callback, hndl_websocket, p_context, data, callback_type](auto buffer, auto size)
                                   {
         std::string message(reinterpret_cast<const char*>(buffer), size);
         free(buffer);
 
-            g_RipExt.Defer([callback, hndl_websocket, message, p_context, data,callback_type]() {
+            g_RipExt.Defer([weak, callback, hndl_websocket, message, p_context, data,callback_type]() {
+                auto connection = websocket_lock(weak);
+                if (!connection)
+                {
+                    return;
+                }
+
 			    callback->PushCell(hndl_websocket);
                 if(callback_type == WebSocket_JSON)
                 {
@@ -99,9 +249,15 @@ static cell_t native_SetReadCallback(IPluginContext *p_context, const cell_t *pa
                 else if(callback_type == Websocket_STRING)
                 {
                     callback->PushString(message.data());
+                }
+                else if(callback_type == WebSocket_BINARY)
+                {
+                    callback->PushStringEx(const_cast<char *>(message.data()), message.size(), SM_PARAM_STRING_COPY | SM_PARAM_STRING_BINARY, 0);
+                    callback->PushCell(message.size());
                 }
 			    callback->PushCell(data);
 			    callback->Execute(nullptr);
+                connection->inbound_release(message.size());
             }); });
     return 1;
 }
@@ -123,10 +279,16 @@ static cell_t native_SetDisconnectCallback(IPluginContext *p_context, const cell
     }
 
     cell_t data = params[3];
+    std::weak_ptr<websocket_connection_base> weak = connection->shared_from_this();
 
-    connection->set_disconnect_callback([callback, hndl_websocket, p_context, data]()
-                                        { g_RipExt.Defer([callback, hndl_websocket, p_context, data]()
+    connection->set_disconnect_callback([weak, callback, hndl_websocket, p_context, data]()
+                                        { g_RipExt.Defer([weak, callback, hndl_websocket, p_context, data]()
                                                          {
+            if (!websocket_lock(weak))
+            {
+                return;
+            }
+
             callback->PushCell(hndl_websocket);
             callback->PushCell(data);
             callback->Execute(nullptr); }); });
@@ -151,10 +313,16 @@ static cell_t native_SetConnectCallback(IPluginContext *p_context, const cell_t
     }
 
     cell_t data = params[3];
+    std::weak_ptr<websocket_connection_base> weak = connection->shared_from_this();
 
-    connection->set_connect_callback([callback, hndl_websocket, p_context, data]()
-                                     { g_RipExt.Defer([callback, hndl_websocket, p_context, data]()
+    connection->set_connect_callback([weak, callback, hndl_websocket, p_context, data]()
+                                     { g_RipExt.Defer([weak, callback, hndl_websocket, p_context, data]()
                                                       {
+            if (!websocket_lock(weak))
+            {
+                return;
+            }
+
             callback->PushCell(hndl_websocket);
             callback->PushCell(data);
             callback->Execute(nullptr); }); });
@@ -177,11 +345,29 @@ static cell_t native_Write(IPluginContext *p_context, const cell_t *params)
         return 0;
     }
 
-    char *result;
+    // Plugins compiled against the old Write(JSON json) only pass two arguments.
+    size_t flags = params[0] >= 3 ? (size_t)params[3] : 0;
+    bool serialize_async = params[0] >= 4 && params[4];
+    if (serialize_async)
+    {
+        // Serialize on the network thread, the game thread only pays for the copy.
+        json_t *copy = json_deep_copy(object);
+        if (copy == nullptr)
+        {
+            return 0;
+        }
+
+        connection->write_json(copy, flags);
+        return 1;
+    }
 
-    result = json_dumps(object, 0);
+    std::string data;
+    if (!connection->serialize_json(object, flags, data))
+    {
+        return 0;
+    }
 
-    connection->write(boost::asio::buffer(result, strlen(result)));
+    connection->write(std::move(data), false);
     return 1;
 }
 
@@ -197,7 +383,33 @@ static cell_t native_WriteString(IPluginContext *p_context, const cell_t *params
 
     p_context->LocalToString(params[2], &result);
 
-    connection->write(boost::asio::buffer(result, strlen(result)));
+    connection->write(std::string(result), false);
+    return 1;
+}
+
+static cell_t native_WriteBinary(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    char *data;
+    p_context->LocalToString(params[2], &data);
+
+    // Natives don't see the array size, so at least make sure the whole range lies
+    // inside the plugin's memory before copying it.
+    cell_t length = params[3];
+    cell_t *last;
+    if (length < 0 || (length > 0 && (static_cast<int64_t>(params[2]) + length - 1 > INT32_MAX
+                                      || p_context->LocalToPhysAddr(params[2] + length - 1, &last) != SP_ERROR_NONE)))
+    {
+        p_context->ReportError("Invalid binary length %d", length);
+        return 0;
+    }
+
+    connection->write(std::string(data, length), true);
     return 1;
 }
 
@@ -216,6 +428,203 @@ static cell_t native_SetHeader(IPluginContext *p_context, const cell_t *params)
     return 1;
 }
 
+static cell_t native_AddSubProtocol(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    char *protocol;
+    p_context->LocalToString(params[2], &protocol);
+    if (protocol[0] == '\0')
+    {
+        p_context->ReportError("Subprotocol name cannot be empty");
+        return 0;
+    }
+
+    connection->add_subprotocol(std::string(protocol));
+    return 1;
+}
+
+static cell_t native_GetProtocol(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    std::string protocol;
+    if (!connection->get_protocol(protocol))
+    {
+        return 0;
+    }
+
+    p_context->StringToLocalUTF8(params[2], params[3], protocol.c_str(), nullptr);
+    return 1;
+}
+
+static cell_t native_GetResponseHeader(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    char *name;
+    p_context->LocalToString(params[2], &name);
+
+    std::string value;
+    if (!connection->get_response_header(std::string(name), value))
+    {
+        return 0;
+    }
+
+    p_context->StringToLocalUTF8(params[3], params[4], value.c_str(), nullptr);
+    return 1;
+}
+
+static cell_t native_SetHandshakeTimeout(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    connection->set_handshake_timeout(std::chrono::milliseconds(params[2] < 0 ? -1 : params[2]));
+    return 1;
+}
+
+static cell_t native_SetConnectTimeout(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    connection->set_connect_timeout(std::chrono::milliseconds(params[2] < 0 ? 0 : params[2]));
+    return 1;
+}
+
+static cell_t native_SetReconnectPolicy(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    if (params[2] < 0 || params[3] < 0 || params[5] < 0 || params[6] < 0)
+    {
+        p_context->ReportError("Reconnect policy values cannot be negative");
+        return 0;
+    }
+
+    websocket_reconnect_policy policy;
+    policy.base_delay = std::chrono::milliseconds(params[2]);
+    policy.max_delay = std::chrono::milliseconds(params[3]);
+    policy.jitter = std::min(std::max(sp_ctof(params[4]), 0.0f), 1.0f);
+    policy.max_attempts = params[5];
+    policy.max_buffered_bytes = params[6];
+
+    connection->set_reconnect_policy(policy);
+    return 1;
+}
+
+static cell_t native_SetMaxMessageSize(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    connection->set_read_message_max(params[2] < 0 ? -1 : params[2]);
+    return 1;
+}
+
+static cell_t native_SetIdleTimeout(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    connection->set_idle_timeout(std::chrono::milliseconds(params[2] < 0 ? -1 : params[2]));
+    return 1;
+}
+
+static cell_t native_SetPingInterval(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    connection->set_ping_interval(std::chrono::milliseconds(params[2] < 0 ? 0 : params[2]));
+    return 1;
+}
+
+static cell_t native_GetLatency(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return sp_ftoc(-1.0f);
+    }
+
+    return sp_ftoc(static_cast<float>(connection->get_latency()));
+}
+
+static cell_t native_SetInboundBudget(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return 0;
+    }
+
+    connection->set_inbound_budget(params[2] < 0 ? 0 : params[2], params[3] < 0 ? 0 : params[3]);
+    return 1;
+}
+
+static cell_t native_GetStats(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_connection_base *connection;
+    if (websocket_read_handle(params[1], p_context, &connection) != HandleError_None)
+    {
+        return BAD_HANDLE;
+    }
+
+    websocket_stats stats = connection->get_stats();
+    json_t *object = json_object();
+    json_object_set_new(object, "bytes_in", json_integer(static_cast<json_int_t>(stats.bytes_in)));
+    json_object_set_new(object, "bytes_out", json_integer(static_cast<json_int_t>(stats.bytes_out)));
+    json_object_set_new(object, "messages_in", json_integer(static_cast<json_int_t>(stats.messages_in)));
+    json_object_set_new(object, "messages_out", json_integer(static_cast<json_int_t>(stats.messages_out)));
+    json_object_set_new(object, "queued_messages", json_integer(static_cast<json_int_t>(stats.queued_messages)));
+    json_object_set_new(object, "queued_bytes", json_integer(static_cast<json_int_t>(stats.queued_bytes)));
+    json_object_set_new(object, "inbound_messages", json_integer(static_cast<json_int_t>(stats.inbound_messages)));
+    json_object_set_new(object, "inbound_bytes", json_integer(static_cast<json_int_t>(stats.inbound_bytes)));
+    json_object_set_new(object, "reconnects", json_integer(stats.reconnects));
+    json_object_set_new(object, "handshake_ms", json_real(stats.handshake_us < 0 ? -1.0 : stats.handshake_us / 1000.0));
+    json_object_set_new(object, "memory", json_integer(static_cast<json_int_t>(connection->approx_size())));
+
+    Handle_t hndl = handlesys->CreateHandle(htJSON, object, p_context->GetIdentity(), myself->GetIdentity(), nullptr);
+    if (hndl == BAD_HANDLE)
+    {
+        json_decref(object);
+    }
+    return hndl;
+}
+
 static cell_t native_WebSocket(IPluginContext *p_context, const cell_t *params)
 {
     char *s_url;
@@ -223,7 +632,7 @@ static cell_t native_WebSocket(IPluginContext *p_context, const cell_t *params)
     try
     {
         Url url(s_url);
-        websocket_connection_base *connection;
+        std::shared_ptr<websocket_connection_base> connection;
         if (url.path().empty())
         {
             url.path("/");
@@ -254,7 +663,7 @@ static cell_t native_WebSocket(IPluginContext *p_context, const cell_t *params)
             {
                 url.port("443");
             }
-            connection = new websocket_connection_ssl(host, path, stoi(url.port()));
+            connection = std::make_shared<websocket_connection_ssl>(host, path, stoi(url.port()));
         }
         else if (url.scheme() == "ws")
         {
@@ -262,10 +671,21 @@ static cell_t native_WebSocket(IPluginContext *p_context, const cell_t *params)
             {
                 url.port("80");
             }
-            connection = new websocket_connection(host, path, stoi(url.port()));
+            connection = std::make_shared<websocket_connection_plain>(host, path, stoi(url.port()));
+        }
+        else
+        {
+            p_context->ReportError("Unsupported websocket scheme: %s", url.scheme().c_str());
+            return 0;
         }
 
-        return handlesys->CreateHandle(htWebSocket, connection, p_context->GetIdentity(), myself->GetIdentity(), nullptr);
+        // The handle only borrows the connection, the event loop keeps it alive until it is closed.
+        Handle_t hndl = handlesys->CreateHandle(htWebSocket, connection.get(), p_context->GetIdentity(), myself->GetIdentity(), nullptr);
+        if (hndl != BAD_HANDLE)
+        {
+            event_loop.add_connection(std::move(connection));
+        }
+        return hndl;
     }
     catch (...)
     {
@@ -296,16 +716,142 @@ static cell_t native_WsOpen(IPluginContext *p_context, const cell_t *params)
     return connection->ws_open();
 }
 
+static cell_t native_WebSocketServer(IPluginContext *p_context, const cell_t *params)
+{
+    char *address;
+    p_context->LocalToString(params[1], &address);
+    if (params[2] < 0 || params[2] > 65535)
+    {
+        p_context->ReportError("Invalid port %d", params[2]);
+        return 0;
+    }
+
+    auto server = std::make_shared<websocket_server>(std::string(address), static_cast<uint16_t>(params[2]));
+    Handle_t hndl = handlesys->CreateHandle(htWebSocketServer, server.get(), p_context->GetIdentity(), myself->GetIdentity(), nullptr);
+    if (hndl != BAD_HANDLE)
+    {
+        event_loop.add_server(std::move(server));
+    }
+    return hndl;
+}
+
+static cell_t native_WebSocketServer_SetConnectCallback(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_server *server;
+    Handle_t hndl_server = params[1];
+    if (websocket_server_read_handle(hndl_server, p_context, &server) != HandleError_None)
+    {
+        return 0;
+    }
+
+    if (server->listening())
+    {
+        p_context->ReportError("The connect callback must be set before Start()");
+        return 0;
+    }
+
+    IPluginFunction *callback = p_context->GetFunctionById((funcid_t)params[2]);
+    if (!callback)
+    {
+        p_context->ReportError("Invalid handler callback provided");
+        return 0;
+    }
+
+    cell_t data = params[3];
+    IdentityToken_t *owner = p_context->GetIdentity();
+    std::weak_ptr<websocket_server> weak = server->shared_from_this();
+
+    server->set_connect_callback([weak, callback, hndl_server, owner, data](std::shared_ptr<websocket_connection_plain> session)
+                                 { g_RipExt.Defer([weak, callback, hndl_server, owner, data, session]()
+                                                  {
+            auto server = weak.lock();
+            if (!server || server->destroyed())
+            {
+                session->destroy();
+                return;
+            }
+
+            // The client handle belongs to the plugin that owns the server, like any WebSocket it must be deleted.
+            Handle_t hndl_client = handlesys->CreateHandle(htWebSocket, session.get(), owner, myself->GetIdentity(), nullptr);
+            if (hndl_client == BAD_HANDLE)
+            {
+                session->destroy();
+                return;
+            }
+            event_loop.add_connection(session);
+
+            std::string remote = session->get_address();
+            callback->PushCell(hndl_server);
+            callback->PushCell(hndl_client);
+            callback->PushString(remote.c_str());
+            callback->PushCell(data);
+            callback->Execute(nullptr);
+
+            session->start_reading(); }); });
+
+    return 1;
+}
+
+static cell_t native_WebSocketServer_Start(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_server *server;
+    if (websocket_server_read_handle(params[1], p_context, &server) != HandleError_None)
+    {
+        return 0;
+    }
+
+    if (server->listening())
+    {
+        return 1;
+    }
+
+    std::string error;
+    if (!server->listen(error))
+    {
+        g_RipExt.LogError("%s", error.c_str());
+        return 0;
+    }
+    return 1;
+}
+
+static cell_t native_WebSocketServer_GetPort(IPluginContext *p_context, const cell_t *params)
+{
+    websocket_server *server;
+    if (websocket_server_read_handle(params[1], p_context, &server) != HandleError_None)
+    {
+        return 0;
+    }
+
+    return server->local_port();
+}
+
 const sp_nativeinfo_t websocket_natives[] = {
     {"WebSocket.WebSocket", native_WebSocket},
     {"WebSocket.Connect", native_Connect},
     {"WebSocket.SetHeader", native_SetHeader},
+    {"WebSocket.AddSubProtocol", native_AddSubProtocol},
+    {"WebSocket.GetProtocol", native_GetProtocol},
+    {"WebSocket.GetResponseHeader", native_GetResponseHeader},
+    {"WebSocket.SetHandshakeTimeout", native_SetHandshakeTimeout},
+    {"WebSocket.SetConnectTimeout", native_SetConnectTimeout},
+    {"WebSocket.SetReconnectPolicy", native_SetReconnectPolicy},
+    {"WebSocket.SetMaxMessageSize", native_SetMaxMessageSize},
+    {"WebSocket.SetIdleTimeout", native_SetIdleTimeout},
+    {"WebSocket.SetPingInterval", native_SetPingInterval},
+    {"WebSocket.GetLatency", native_GetLatency},
+    {"WebSocket.GetStats", native_GetStats},
+    {"WebSocket.SetInboundBudget", native_SetInboundBudget},
     {"WebSocket.Close", native_Close},
     {"WebSocket.SetReadCallback", native_SetReadCallback},
     {"WebSocket.SetDisconnectCallback", native_SetDisconnectCallback},
     {"WebSocket.SetConnectCallback", native_SetConnectCallback},
     {"WebSocket.Write", native_Write},
     {"WebSocket.WriteString", native_WriteString},
+    {"WebSocket.WriteBinary", native_WriteBinary},
     {"WebSocket.SocketOpen", native_SocketOpen},
     {"WebSocket.WsOpen", native_WsOpen},
+    {"WebSocketServer.WebSocketServer", native_WebSocketServer},
+    {"WebSocketServer.SetConnectCallback", native_WebSocketServer_SetConnectCallback},
+    {"WebSocketServer.Start", native_WebSocketServer_Start},
+    {"WebSocketServer.GetPort", native_WebSocketServer_GetPort},
     {nullptr, nullptr}};
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "websocket_server.h"
+#include "websocket_eventloop.h"
+
+websocket_server::websocket_server(std::string address, uint16_t port)
+    : strand(boost::asio::make_strand(event_loop.get_context())), acceptor(strand), accept_timer(strand), address(address), port(port)
+{
+}
+
+bool websocket_server::listen(std::string &error)
+{
+    beast::error_code ec;
+    auto ip = boost::asio::ip::make_address(this->address, ec);
+    if (ec)
+    {
+        error = "Invalid listen address " + this->address + ": " + ec.message();
+        return false;
+    }
+
+    tcp::endpoint endpoint(ip, this->port);
+    this->acceptor.open(endpoint.protocol(), ec);
+    if (!ec)
+    {
+        this->acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+    }
+    if (!ec)
+    {
+        this->acceptor.bind(endpoint, ec);
+    }
+    if (!ec)
+    {
+        this->acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+    }
+    if (ec)
+    {
+        error = "Could not listen on " + this->address + ":" + std::to_string(this->port) + ": " + ec.message();
+        beast::error_code ignored;
+        this->acceptor.close(ignored);
+        return false;
+    }
+
+    // Port 0 picks a free port, report the one that was actually bound.
+    this->port = this->acceptor.local_endpoint(ec).port();
+    this->is_listening = true;
+    boost::asio::post(this->strand, beast::bind_front_handler(&websocket_server::do_accept, this->shared_from_this()));
+    return true;
+}
+
+void websocket_server::set_connect_callback(connect_handler callback)
+{
+    this->connect_callback = std::make_unique<connect_handler>(callback);
+}
+
+void websocket_server::do_accept()
+{
+    if (this->pending_delete || !this->acceptor.is_open())
+    {
+        return;
+    }
+
+    auto session = std::make_shared<websocket_connection_plain>(this->address, "", this->port);
+    this->acceptor.async_accept(session->accept_socket(), beast::bind_front_handler(&websocket_server::on_accept, this->shared_from_this(), session));
+}
+
+void websocket_server::on_accept(std::shared_ptr<websocket_connection_plain> session, beast::error_code ec)
+{
+    if (ec == boost::asio::error::operation_aborted || this->pending_delete)
+    {
+        return;
+    }
+
+    if (ec)
+    {
+        this->accept_delay = std::min(std::max(this->accept_delay * 2, std::chrono::milliseconds(100)), std::chrono::milliseconds(5000));
+        g_RipExt.LogError("WebSocket server %s:%d accept error: %d %s, retrying in %lld ms", this->address.c_str(), this->port, ec.value(), ec.message().c_str(), static_cast<long long>(this->accept_delay.count()));
+        this->accept_timer.expires_after(this->accept_delay);
+        this->accept_timer.async_wait(beast::bind_front_handler(&websocket_server::on_accept_timer, this->shared_from_this()));
+        return;
+    }
+
+    this->accept_delay = std::chrono::milliseconds(0);
+    if (this->connect_callback)
+    {
+        // The session only refers to itself weakly, until the game thread wraps it in a
+        // handle it is kept alive by its pending handlers.
+        std::weak_ptr<websocket_connection_plain> weak_session = session;
+        auto callback = *this->connect_callback;
+        session->set_connect_callback([weak_session, callback]()
+                                      {
+            if (auto session = weak_session.lock())
+            {
+                callback(session);
+            } });
+        session->accept();
+    }
+
+    this->do_accept();
+}
+
+void websocket_server::on_accept_timer(beast::error_code ec)
+{
+    if (ec || this->pending_delete)
+    {
+        return;
+    }
+
+    this->do_accept();
+}
+
+void websocket_server::destroy()
+{
+    this->pending_delete = true;
+    this->is_listening = false;
+    boost::asio::post(this->strand, [self = this->shared_from_this()]()
+                      {
+        beast::error_code ec;
+        self->accept_timer.cancel();
+        self->acceptor.close(ec); });
+    event_loop.remove_server(this);
+}
+
+bool websocket_server::destroyed()
+{
+    return this->pending_delete;
+}
+
+bool websocket_server::listening()
+{
+    return this->is_listening;
+}
+
+uint16_t websocket_server::local_port()
+{
+    return this->port;
+}
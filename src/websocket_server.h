@@ -0,0 +1,49 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include "websocket_connection.h"
+
+namespace beast = boost::beast;
+using tcp = boost::asio::ip::tcp;
+
+// Listens for plain ws:// connections, meant for sidecar processes on the same machine.
+// Every accepted client becomes an ordinary websocket_connection in server role, so
+// reads, writes and closing go through the regular WebSocket natives.
+class websocket_server : public std::enable_shared_from_this<websocket_server>
+{
+public:
+    using connect_handler = std::function<void(std::shared_ptr<websocket_connection_plain>)>;
+
+    websocket_server(std::string address, uint16_t port);
+
+    // Binds and starts accepting, runs on the game thread before any handler exists.
+    bool listen(std::string &error);
+    void set_connect_callback(connect_handler callback);
+    void destroy();
+    bool destroyed();
+    bool listening();
+    uint16_t local_port();
+
+private:
+    void do_accept();
+    void on_accept(std::shared_ptr<websocket_connection_plain> session, beast::error_code ec);
+    void on_accept_timer(beast::error_code ec);
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand;
+    tcp::acceptor acceptor;
+    boost::asio::steady_timer accept_timer;
+    // Doubles after every failed accept, so running out of descriptors doesn't spin the event loop.
+    std::chrono::milliseconds accept_delay{0};
+    std::string address;
+    uint16_t port;
+    std::unique_ptr<connect_handler> connect_callback;
+    std::atomic<bool> is_listening{false};
+    std::atomic<bool> pending_delete{false};
+};